@@ -11,8 +11,37 @@ _lib = _audiokit.lib
 
 FILENAME : Final[str] = "./data/file_example_WAV_2MG.wav"
 
+FEATURE_ZCR : Final[int] = _lib.FEATURE_ZCR
+FEATURE_RMS : Final[int] = _lib.FEATURE_RMS
+FEATURE_ENVELOPE : Final[int] = _lib.FEATURE_ENVELOPE
+FEATURE_ALL : Final[int] = _lib.FEATURE_ALL
+
+WINDOW_HANN : Final[int] = _lib.WINDOW_HANN
+WINDOW_HAMMING : Final[int] = _lib.WINDOW_HAMMING
+WINDOW_RECTANGULAR : Final[int] = _lib.WINDOW_RECTANGULAR
+
+SPECTRAL_FEATURES : Final[tuple[str, ...]] = ("centroid", "bandwidth", "rolloff", "flatness", "flux")
+
 # ################################ HELPERS ################################
 
+# Wraps a malloc'ed C array into a numpy array without copying it.
+# The buffer is freed by the C allocator once the array and all its views are collected.
+def _owned_array(c_ptr, count : int, dtype) -> np.ndarray:
+    dtype = np.dtype(dtype)
+    if c_ptr == _ffi.NULL or count == 0:
+        if c_ptr != _ffi.NULL:
+            _lib.free(c_ptr)
+        return np.empty(0, dtype=dtype)
+    owner = _ffi.gc(_ffi.cast("char *", c_ptr), _lib.free)
+    return np.frombuffer(_ffi.buffer(owner, count*dtype.itemsize), dtype=dtype)
+
+# The int16 C functions get int16 samples or a TypeError: casting would truncate float32 samples in [-1, 1) to zeros.
+def _int16_samples(data : np.ndarray, name : str) -> np.ndarray:
+    dtype = np.asarray(data).dtype
+    if dtype != np.int16:
+        raise TypeError(f"{name}: int16 samples expected, got {dtype}")
+    return np.ascontiguousarray(data)
+
 @dataclass
 class WaveData:
     riff : str
@@ -33,18 +62,36 @@ class WaveData:
     sample_number : int
     audio_length_s : float
 
+@dataclass
+class FileAnalysis:
+    path : str
+    status : int
+    message : str
+    sample_rate : int
+    channels : int
+    frame_number : int
+    features : dict[str, np.ndarray]
+
 class ErrorHandler:
     def __init__(self):
         pass
     
+    # The C error state is thread-local: read it from the thread that made the failing call
+    @staticmethod
     def get_last_error_message() -> str:
         c_error_message = _lib.last_error_message()
-        message_bytes_size = _ffi.sizeof(c_error_message)
-        return bytes(_ffi.buffer(c_error_message, message_bytes_size)).decode("ascii", errors="replace")
+        if c_error_message == _ffi.NULL:
+            return ""
+        return _ffi.string(c_error_message).decode("ascii", errors="replace")
     
+    @staticmethod
     def handle_output(output : int) -> None:
         if output == 0: return
         
+        # Legacy loader (retrieve_wav_data) status codes are negative
+        if output < 0:
+            raise ValueError(f"cannot load wav data (code {output})")
+        
         last_error_message = ErrorHandler.get_last_error_message()
 
         match output:
@@ -59,17 +106,38 @@ class ErrorHandler:
             case 5:
                 raise RuntimeError(last_error_message)
             
+# Persistent C worker threads, shared by every call that receives it
+class ThreadPool:
+    def __init__(self, n_threads : int = 0) -> None:
+        p = _ffi.new("struct thread_pool **")
+        ErrorHandler.handle_output(_lib.thread_pool_create(n_threads, p))
+        self._pool = _ffi.gc(p[0], _lib.thread_pool_free)
+    
+    @property
+    def size(self) -> int:
+        return int(_lib.thread_pool_size(self._pool))
+
 # Interface contributing to link C functions with Python Call  
 class AudiokitInterface:
     def __init__(self) -> None:
         pass
     
     @staticmethod
-    def retrieve_wav_data(filename : str) -> WaveData:
+    def retrieve_wav_data(filename : str, planar : bool = False) -> WaveData:
+        # planar=True loads the samples straight into one contiguous row per channel: data is (channels, frames)
+        if planar:
+            h = _ffi.new("struct wav_header *")
+            a = _ffi.new("struct planar_audio *")
+            ErrorHandler.handle_output(_lib.retrieve_wav_data_planar(filename.encode("utf-8"), h, a))
+            channels, frame_number = int(a.channels), int(a.frames)
+            # The array takes ownership of a.data, planar_audio_free must not be called
+            data = _owned_array(a.data, channels*frame_number, np.int16).reshape(channels, frame_number)
+            return AudiokitInterface._wave_data(h[0], frame_number, data)
+        
         # We initialize the pointer of type struct HEADER that 
         h = _ffi.new("struct wav_header *")
         s = _ffi.new("int16_t **")
-        f = _ffi.new("uint32_t *")
+        f = _ffi.new("uint64_t *")
         
         # We read the wav file and retrieve all of his data (header and content)
         # The output is used as an error indicator (0 : OK, > 0 : Error)
@@ -78,12 +146,12 @@ class AudiokitInterface:
         # Handling errors
         ErrorHandler.handle_output(output)
         
-        # We retrieve the header struct from the output pointer 
-        c_header = h[0]
-        c_data = s[0]
-        c_frame = f[0]
-        
-        frame_number : int = int(c_frame)
+        frame_number : int = int(f[0])
+        channels : int = int(h.num_channels)
+        return AudiokitInterface._wave_data(h[0], frame_number, _owned_array(s[0], frame_number*channels, np.int16))
+    
+    @staticmethod
+    def _wave_data(c_header, frame_number : int, data : np.ndarray) -> WaveData:
         channels : int = int(c_header.num_channels)
         sample_number : int = frame_number*channels
         data_size : int = int(c_header.subchunk2_size)
@@ -105,7 +173,7 @@ class AudiokitInterface:
             block_align=int(c_header.block_align),
             bits_per_sample=int(c_header.bits_per_sample),
             data_size=data_size,
-            data= np.array(_ffi.unpack(c_data, sample_number)),
+            data=data,
             frame_number= int(frame_number),
             sample_number=sample_number,
             audio_length_s=audio_length_s
@@ -114,26 +182,588 @@ class AudiokitInterface:
         return wave_data
     
     @staticmethod
-    def zero_crossing_rate(data : np.ndarray, frame_number : int, frame_length : int, hop_length : int, center : int) -> np.ndarray:
+    def _into(c_function, data : np.ndarray, frame_number : int, frame_length : int, hop_length : int, center : int, out : np.ndarray) -> np.ndarray:
+        if out.dtype != np.float32 or not out.flags.c_contiguous or not out.flags.writeable:
+            raise ValueError("out must be a writeable contiguous float32 array")
         
-        z = _ffi.new("float **")
         f = _ffi.new("size_t *")
+        # No float32 *_into variant: float32 samples go through the allocating call (out=None)
+        data = _int16_samples(data, c_function.__name__)
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        c_out = _ffi.cast('float*', out.ctypes.data)
+        
+        ErrorHandler.handle_output(c_function(c_data, frame_number, frame_length, hop_length, center, c_out, out.size, f))
+        return out[:int(f[0])]
+    
+    @staticmethod
+    def feature_frame_count(frame_number : int, frame_length : int, hop_length : int, center : int) -> int:
+        return int(_lib.feature_frame_count(frame_number, frame_length, hop_length, center))
+    
+    @staticmethod
+    def retrieve_wav_samples_f32(filename : str) -> tuple[np.ndarray, int, int]:
+        # Decodes any supported encoding (8/16/24/32-bit PCM, float) to float32 in [-1, 1)
+        h = _ffi.new("struct wav_header *")
+        s = _ffi.new("void **")
+        f = _ffi.new("uint64_t *")
+        
+        ErrorHandler.handle_output(_lib.retrieve_wav_data_as(filename.encode("utf-8"), _lib.SAMPLE_F32, h, s, f))
         
+        channels = int(h.num_channels)
+        sample_number = int(f[0])*channels
+        data = _owned_array(s[0], sample_number, np.float32)
+        return data, int(h.sample_rate), channels
+    
+    @staticmethod
+    def retrieve_wav_data_channels(filename : str, channels : list[int] | None = None, as_float : bool = False) -> np.ndarray:
+        # channels=None downmixes to mono (1-D result), otherwise keeps the listed channels (frames, len(channels))
+        h = _ffi.new("struct wav_header *")
+        s = _ffi.new("void **")
+        f = _ffi.new("uint64_t *")
+        c = _ffi.new("uint16_t *")
+        
+        if channels is None:
+            sel = _ffi.new("struct channel_selection *", {"mode": _lib.CHANNELS_DOWNMIX})
+        else:
+            c_channels = _ffi.new("uint16_t[]", channels)
+            sel = _ffi.new("struct channel_selection *", {"mode": _lib.CHANNELS_SELECT, "channels": c_channels, "n_channels": len(channels)})
+        
+        sample_type = _lib.SAMPLE_F32 if as_float else _lib.SAMPLE_S16
+        ErrorHandler.handle_output(_lib.retrieve_wav_data_channels(filename.encode("utf-8"), sample_type, sel, h, s, f, c))
+        
+        kept = int(c[0])
+        sample_number = int(f[0])*kept
+        data = _owned_array(s[0], sample_number, np.float32 if as_float else np.int16)
+        return data if channels is None else data.reshape(-1, kept)
+    
+    @staticmethod
+    def retrieve_wav_data_range(filename : str, start_frame : int, n_frames : int, as_float : bool = False) -> np.ndarray:
+        # Frames [start_frame, start_frame + n_frames) shaped (frames, channels), only that range is read
+        h = _ffi.new("struct wav_header *")
+        s = _ffi.new("void **")
+        f = _ffi.new("uint64_t *")
+        
+        sample_type = _lib.SAMPLE_F32 if as_float else _lib.SAMPLE_S16
+        ErrorHandler.handle_output(_lib.retrieve_wav_data_range(filename.encode("utf-8"), sample_type, start_frame, n_frames, h, s, f))
+        
+        channels = int(h.num_channels)
+        data = _owned_array(s[0], int(f[0])*channels, np.float32 if as_float else np.int16)
+        return data.reshape(-1, channels)
+    
+    @staticmethod
+    def trim_silence(data : np.ndarray, channels : int = 1, threshold_db : float = -60.0, block_length : int = 512) -> tuple[int, int]:
+        # [start, end) frames of interleaved int16 data once leading and trailing silence are skipped
+        s = _ffi.new("uint64_t *")
+        e = _ffi.new("uint64_t *")
+        
+        data = _int16_samples(data, "trim_silence")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.trim_silence(c_data, data.size // channels, channels, threshold_db, block_length, s, e))
+        
+        return int(s[0]), int(e[0])
+    
+    @staticmethod
+    def split_silence(data : np.ndarray, channels : int = 1, threshold_db : float = -60.0, block_length : int = 512, min_silence : int = 0, min_region : int = 0) -> np.ndarray:
+        # Active regions as an (n_regions, 2) array of [start, end) frames, like librosa.effects.split
+        r = _ffi.new("struct audio_region **")
+        n = _ffi.new("size_t *")
+        
+        data = _int16_samples(data, "split_silence")
         c_data = _ffi.cast('int16_t*', data.ctypes.data)
         
-        output = _lib.zero_crossing_rate(c_data, frame_number, frame_length, hop_length, center, z, f)
+        ErrorHandler.handle_output(_lib.split_silence(c_data, data.size // channels, channels, threshold_db, block_length, min_silence, min_region, r, n))
+        
+        return _owned_array(r[0], 2*int(n[0]), np.uint64).reshape(-1, 2)
+    
+    @staticmethod
+    def zero_crossing_rate(data : np.ndarray, frame_number : int, frame_length : int, hop_length : int, center : int, out : np.ndarray | None = None) -> np.ndarray:
+        
+        z = _ffi.new("float **")
+        f = _ffi.new("size_t *")
+        
+        # Caller buffer: no allocation, the result is a view of out
+        if out is not None:
+            return AudiokitInterface._into(_lib.zero_crossing_rate_into, data, frame_number, frame_length, hop_length, center, out)
+        
+        if data.dtype == np.float32:
+            data = np.ascontiguousarray(data)
+            c_data = _ffi.cast('float*', data.ctypes.data)
+            output = _lib.zero_crossing_rate_f32(c_data, frame_number, frame_length, hop_length, center, z, f)
+        else:
+            data = _int16_samples(data, "zero_crossing_rate")
+            c_data = _ffi.cast('int16_t*', data.ctypes.data)
+            output = _lib.zero_crossing_rate(c_data, frame_number, frame_length, hop_length, center, z, f)
         
         ErrorHandler.handle_output(output)
         
         c_zcr = z[0]
         n_frame = int(f[0])
                 
-        return np.array(_ffi.unpack(c_zcr, n_frame))
+        return _owned_array(c_zcr, n_frame, np.float32)
+    
+    @staticmethod
+    def rms(data : np.ndarray, frame_number : int, frame_length : int, hop_length : int, center : int, out : np.ndarray | None = None) -> np.ndarray:
+        
+        r = _ffi.new("float **")
+        f = _ffi.new("size_t *")
+        
+        # Caller buffer: no allocation, the result is a view of out
+        if out is not None:
+            return AudiokitInterface._into(_lib.rms_into, data, frame_number, frame_length, hop_length, center, out)
+        
+        if data.dtype == np.float32:
+            data = np.ascontiguousarray(data)
+            c_data = _ffi.cast('float*', data.ctypes.data)
+            output = _lib.rms_f32(c_data, frame_number, frame_length, hop_length, center, r, f)
+        else:
+            data = _int16_samples(data, "rms")
+            c_data = _ffi.cast('int16_t*', data.ctypes.data)
+            output = _lib.rms(c_data, frame_number, frame_length, hop_length, center, r, f)
+        
+        ErrorHandler.handle_output(output)
+        
+        c_rms = r[0]
+        n_frame = int(f[0])
+        
+        return _owned_array(c_rms, n_frame, np.float32)
+    
+    @staticmethod
+    def amplitude_envelope(data : np.ndarray, frame_number : int, frame_length : int, hop_length : int, center : int, out : np.ndarray | None = None) -> np.ndarray:
+        
+        e = _ffi.new("float **")
+        f = _ffi.new("size_t *")
+        
+        # Caller buffer: no allocation, the result is a view of out
+        if out is not None:
+            return AudiokitInterface._into(_lib.amplitude_envelope_into, data, frame_number, frame_length, hop_length, center, out)
+        
+        if data.dtype == np.float32:
+            data = np.ascontiguousarray(data)
+            c_data = _ffi.cast('float*', data.ctypes.data)
+            output = _lib.amplitude_envelope_f32(c_data, frame_number, frame_length, hop_length, center, e, f)
+        else:
+            data = _int16_samples(data, "amplitude_envelope")
+            c_data = _ffi.cast('int16_t*', data.ctypes.data)
+            output = _lib.amplitude_envelope(c_data, frame_number, frame_length, hop_length, center, e, f)
+        
+        ErrorHandler.handle_output(output)
+        
+        c_envelope = e[0]
+        n_frame = int(f[0])
+        
+        return _owned_array(c_envelope, n_frame, np.float32)
+    
+    @staticmethod
+    def extract_features(data : np.ndarray, frame_number : int, frame_length : int, hop_length : int, center : int, features : int = FEATURE_ALL, pool : ThreadPool | None = None) -> dict[str, np.ndarray]:
+        
+        fs = _ffi.new("struct feature_set *")
+        
+        data = _int16_samples(data, "extract_features")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        if pool is None:
+            output = _lib.extract_features(c_data, frame_number, frame_length, hop_length, center, features, fs)
+        else:
+            output = _lib.extract_features_mt(pool._pool, c_data, frame_number, frame_length, hop_length, center, features, fs)
+        
+        ErrorHandler.handle_output(output)
+        
+        n_frame = int(fs.n_frames)
+        results : dict[str, np.ndarray] = {}
+        for name, flag in (("zcr", FEATURE_ZCR), ("rms", FEATURE_RMS), ("envelope", FEATURE_ENVELOPE)):
+            if not features & flag:
+                continue
+            c_values = getattr(fs, name)
+            results[name] = _owned_array(c_values, n_frame, np.float32)
+        return results
+    
+    @staticmethod
+    def retrieve_wav_data_planar(filename : str) -> np.ndarray:
+        # One row per channel, each row contiguous
+        return AudiokitInterface.retrieve_wav_data(filename, planar=True).data
+    
+    @staticmethod
+    def extract_features_planar(planar : np.ndarray, frame_length : int, hop_length : int, center : int, features : int = FEATURE_ALL, pool : ThreadPool | None = None) -> dict[str, np.ndarray]:
+        
+        planar = _int16_samples(np.atleast_2d(planar), "extract_features_planar")
+        channels, frame_number = planar.shape
+        a = _ffi.new("struct planar_audio *", {"data": _ffi.cast("int16_t*", planar.ctypes.data), "channels": channels, "frames": frame_number})
+        fs = _ffi.new("struct feature_set *")
+        
+        output = _lib.extract_features_planar(pool._pool if pool is not None else _ffi.NULL, a, frame_length, hop_length, center, features, fs)
+        
+        ErrorHandler.handle_output(output)
+        
+        n_frame = int(fs.n_frames)
+        results : dict[str, np.ndarray] = {}
+        for name, flag in (("zcr", FEATURE_ZCR), ("rms", FEATURE_RMS), ("envelope", FEATURE_ENVELOPE)):
+            if not features & flag:
+                continue
+            c_values = getattr(fs, name)
+            results[name] = _owned_array(c_values, channels*n_frame, np.float32).reshape(channels, n_frame)
+        return results
+    
+    @staticmethod
+    def stft(data : np.ndarray, frame_number : int, n_fft : int, hop_length : int, center : int, window : int = WINDOW_HANN) -> np.ndarray:
+        # Complex spectrum shaped (n_bins, n_frames) like librosa.stft (a transposed view of the C frame-major buffer)
+        s = _ffi.new("float **")
+        b = _ffi.new("size_t *")
+        f = _ffi.new("size_t *")
+        
+        data = _int16_samples(data, "stft")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.stft(c_data, frame_number, n_fft, hop_length, center, window, s, b, f))
+        
+        n_bin, n_frame = int(b[0]), int(f[0])
+        return _owned_array(s[0], 2*n_bin*n_frame, np.float32).view(np.complex64).reshape(n_frame, n_bin).T
+    
+    @staticmethod
+    def stft_magnitude(data : np.ndarray, frame_number : int, n_fft : int, hop_length : int, center : int, window : int = WINDOW_HANN, power : float = 1.0) -> np.ndarray:
+        m = _ffi.new("float **")
+        b = _ffi.new("size_t *")
+        f = _ffi.new("size_t *")
+        
+        data = _int16_samples(data, "stft_magnitude")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.stft_magnitude(c_data, frame_number, n_fft, hop_length, center, window, power, m, b, f))
+        
+        n_bin, n_frame = int(b[0]), int(f[0])
+        return _owned_array(m[0], n_bin*n_frame, np.float32).reshape(n_frame, n_bin).T
+    
+    @staticmethod
+    def istft(spectrum : np.ndarray, hop_length : int, center : int, window : int = WINDOW_HANN, n_fft : int | None = None, length : int = 0) -> np.ndarray:
+        # spectrum is (n_bins, n_frames) as returned by stft
+        n_bin, n_frame = spectrum.shape
+        n_fft = 2*(n_bin - 1) if n_fft is None else n_fft
+        frames = np.ascontiguousarray(spectrum.T, dtype=np.complex64)
+        c_spectrum = _ffi.cast('float*', frames.ctypes.data)
+        y = _ffi.new("float **")
+        n = _ffi.new("size_t *")
+        
+        ErrorHandler.handle_output(_lib.istft(c_spectrum, n_fft, n_frame, hop_length, center, window, length, y, n))
+        
+        return _owned_array(y[0], int(n[0]), np.float32)
+    
+    @staticmethod
+    def _mel_params(sr : int, n_fft : int, hop_length : int, center : int, window : int, power : float, n_mels : int, fmin : float, fmax : float | None):
+        p = _ffi.new("struct mel_params *")
+        _lib.mel_params_default(p, sr)
+        p.n_fft, p.hop_length, p.center, p.window, p.power = n_fft, hop_length, center, window, power
+        p.n_mels, p.fmin, p.fmax = n_mels, fmin, 0.0 if fmax is None else fmax
+        return p
+    
+    @staticmethod
+    def melspectrogram(data : np.ndarray, frame_number : int, sr : int, n_fft : int = 2048, hop_length : int = 512, center : int = 1, window : int = WINDOW_HANN, power : float = 2.0, n_mels : int = 128, fmin : float = 0.0, fmax : float | None = None) -> np.ndarray:
+        # Shaped (n_mels, n_frames) like librosa.feature.melspectrogram, same defaults
+        p = AudiokitInterface._mel_params(sr, n_fft, hop_length, center, window, power, n_mels, fmin, fmax)
+        m = _ffi.new("float **")
+        f = _ffi.new("size_t *")
+        
+        data = _int16_samples(data, "melspectrogram")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.mel_spectrogram(c_data, frame_number, p, m, f))
+        
+        n_frame = int(f[0])
+        return _owned_array(m[0], n_mels*n_frame, np.float32).reshape(n_frame, n_mels).T
+    
+    @staticmethod
+    def mfcc(data : np.ndarray, frame_number : int, sr : int, n_mfcc : int = 20, n_fft : int = 2048, hop_length : int = 512, center : int = 1, window : int = WINDOW_HANN, n_mels : int = 128, fmin : float = 0.0, fmax : float | None = None) -> np.ndarray:
+        # Shaped (n_mfcc, n_frames) like librosa.feature.mfcc, same defaults
+        p = AudiokitInterface._mel_params(sr, n_fft, hop_length, center, window, 2.0, n_mels, fmin, fmax)
+        m = _ffi.new("float **")
+        f = _ffi.new("size_t *")
+        
+        data = _int16_samples(data, "mfcc")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.mfcc(c_data, frame_number, p, n_mfcc, m, f))
+        
+        n_frame = int(f[0])
+        return _owned_array(m[0], n_mfcc*n_frame, np.float32).reshape(n_frame, n_mfcc).T
+    
+    @staticmethod
+    def _spectral_collect(c_function, args : tuple, features : tuple[str, ...]) -> dict[str, np.ndarray]:
+        outs = {name : _ffi.new("float **") if name in features else _ffi.NULL for name in SPECTRAL_FEATURES}
+        f = _ffi.new("size_t *")
+        
+        ErrorHandler.handle_output(c_function(*args, *outs.values(), f))
+        
+        n_frame = int(f[0])
+        return {name : _owned_array(out[0], n_frame, np.float32) for name, out in outs.items() if out != _ffi.NULL}
+    
+    @staticmethod
+    def spectral_features(data : np.ndarray, frame_number : int, sr : int, n_fft : int = 2048, hop_length : int = 512, center : int = 1, window : int = WINDOW_HANN, roll_percent : float = 0.85, features : tuple[str, ...] = SPECTRAL_FEATURES) -> dict[str, np.ndarray]:
+        # One STFT shared by every requested feature, see SPECTRAL_FEATURES for the keys
+        data = _int16_samples(data, "spectral_features")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        args = (c_data, frame_number, sr, n_fft, hop_length, center, window, roll_percent)
+        return AudiokitInterface._spectral_collect(_lib.spectral_features, args, features)
+    
+    @staticmethod
+    def spectral_features_from_magnitude(magnitude : np.ndarray, sr : int, roll_percent : float = 0.85, features : tuple[str, ...] = SPECTRAL_FEATURES) -> dict[str, np.ndarray]:
+        # magnitude is (n_bins, n_frames) as returned by stft_magnitude with power 1
+        n_bin, n_frame = magnitude.shape
+        frames = np.ascontiguousarray(magnitude.T, dtype=np.float32)
+        c_magnitude = _ffi.cast('float*', frames.ctypes.data)
+        args = (c_magnitude, n_bin, n_frame, sr, roll_percent)
+        return AudiokitInterface._spectral_collect(_lib.spectral_features_from_magnitude, args, features)
+    
+    @staticmethod
+    def yin(data : np.ndarray, frame_number : int, fmin : float, fmax : float, sr : int, frame_length : int = 2048, hop_length : int | None = None, center : int = 1, trough_threshold : float = 0.1) -> np.ndarray:
+        # Same defaults as librosa.yin (hop_length = frame_length // 4)
+        hop_length = frame_length // 4 if hop_length is None else hop_length
+        y = _ffi.new("float **")
+        f = _ffi.new("size_t *")
+        
+        data = _int16_samples(data, "yin")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.yin(c_data, frame_number, sr, frame_length, hop_length, center, fmin, fmax, trough_threshold, y, f))
+        
+        return _owned_array(y[0], int(f[0]), np.float32)
+    
+    @staticmethod
+    def loudness(data : np.ndarray, channels : int, sr : int) -> dict[str, float]:
+        # EBU R128 measurements of interleaved int16 samples (retrieve_wav_data layout), see LoudnessMeter
+        st = _ffi.new("struct loudness_stats *")
+        
+        data = _int16_samples(data, "loudness")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.loudness_measure(c_data, data.size // channels, channels, sr, st))
+        
+        return LoudnessMeter._stats_dict(st)
+    
+    @staticmethod
+    def onset_strength(data : np.ndarray, frame_number : int, sr : int, n_fft : int = 2048, hop_length : int = 512, center : int = 1, n_mels : int = 128) -> np.ndarray:
+        # Same envelope as librosa.onset.onset_strength, one value per frame
+        p = AudiokitInterface._mel_params(sr, n_fft, hop_length, center, WINDOW_HANN, 2.0, n_mels, 0.0, None)
+        o = _ffi.new("float **")
+        f = _ffi.new("size_t *")
+        
+        data = _int16_samples(data, "onset_strength")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.onset_strength(c_data, frame_number, p, o, f))
+        
+        return _owned_array(o[0], int(f[0]), np.float32)
+    
+    @staticmethod
+    def onset_detect(data : np.ndarray, frame_number : int, sr : int, n_fft : int = 2048, hop_length : int = 512, center : int = 1, n_mels : int = 128, delta : float = 0.07) -> tuple[np.ndarray, np.ndarray]:
+        # (onset frames, onset times in seconds), peak picking as librosa.onset.onset_detect
+        p = AudiokitInterface._mel_params(sr, n_fft, hop_length, center, WINDOW_HANN, 2.0, n_mels, 0.0, None)
+        op = _ffi.new("struct onset_params *")
+        _lib.onset_params_default(op, sr, hop_length)
+        op.delta = delta
+        fr = _ffi.new("size_t **")
+        t = _ffi.new("float **")
+        n = _ffi.new("size_t *")
+        
+        data = _int16_samples(data, "onset_detect")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.onset_detect(c_data, frame_number, p, op, fr, t, n))
+        
+        count = int(n[0])
+        return _owned_array(fr[0], count, np.uintp), _owned_array(t[0], count, np.float32)
+    
+    @staticmethod
+    def beat_track(data : np.ndarray, frame_number : int, sr : int, n_fft : int = 2048, hop_length : int = 512, center : int = 1, n_mels : int = 128, start_bpm : float = 120.0, tightness : float = 100.0) -> tuple[float, np.ndarray, np.ndarray]:
+        # (tempo in BPM, beat frames, beat times in seconds) like librosa.beat.beat_track
+        p = AudiokitInterface._mel_params(sr, n_fft, hop_length, center, WINDOW_HANN, 2.0, n_mels, 0.0, None)
+        tempo = _ffi.new("double *")
+        fr = _ffi.new("size_t **")
+        t = _ffi.new("float **")
+        n = _ffi.new("size_t *")
+        
+        data = _int16_samples(data, "beat_track")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.beat_track(c_data, frame_number, p, start_bpm, tightness, tempo, fr, t, n))
+        
+        count = int(n[0])
+        return tempo[0], _owned_array(fr[0], count, np.uintp), _owned_array(t[0], count, np.float32)
+    
+    @staticmethod
+    def resample(data : np.ndarray, channels : int, in_rate : int, out_rate : int) -> np.ndarray:
+        # Interleaved int16 or float32 samples (other dtypes are converted to float32), same dtype out
+        data = np.ascontiguousarray(data, dtype=np.int16 if data.dtype == np.int16 else np.float32)
+        y = _ffi.new("void **")
+        f = _ffi.new("size_t *")
+        sample_type = Resampler._sample_type(data.dtype)
+        c_data = _ffi.cast("void*", data.ctypes.data)
+        
+        ErrorHandler.handle_output(_lib.resample(c_data, data.size // channels, channels, sample_type, in_rate, out_rate, y, f))
+        
+        return _owned_array(y[0], int(f[0]) * channels, data.dtype)
+    
+    @staticmethod
+    def analyze_files(paths : list[str], frame_length : int, hop_length : int, center : int, features : int = FEATURE_ALL, pool : ThreadPool | None = None) -> list[FileAnalysis]:
+        
+        c_paths_keepalive = [_ffi.new("char[]", path.encode("utf-8")) for path in paths]
+        c_paths = _ffi.new("const char *[]", c_paths_keepalive)
+        spec = _ffi.new("struct feature_spec *", {"features": features, "frame_length": frame_length, "hop_length": hop_length, "center": center})
+        results = _ffi.new("struct file_result[]", len(paths))
+        
+        output = _lib.analyze_files(pool._pool if pool is not None else _ffi.NULL, c_paths, len(paths), spec, results)
+        
+        ErrorHandler.handle_output(output)
+        
+        analyses : list[FileAnalysis] = []
+        for path, res in zip(paths, results):
+            n_frame = int(res.features.n_frames)
+            values : dict[str, np.ndarray] = {}
+            if res.status == 0:
+                for name, flag in (("zcr", FEATURE_ZCR), ("rms", FEATURE_RMS), ("envelope", FEATURE_ENVELOPE)):
+                    if features & flag:
+                        # The array takes the buffer over, file_results_free then sees NULL
+                        values[name] = _owned_array(getattr(res.features, name), n_frame, np.float32)
+                        setattr(res.features, name, _ffi.NULL)
+            analyses.append(FileAnalysis(
+                path=path,
+                status=int(res.status),
+                message=_ffi.string(res.message).decode("ascii", errors="replace") if res.message != _ffi.NULL else "",
+                sample_rate=int(res.header.sample_rate),
+                channels=int(res.header.num_channels),
+                frame_number=int(res.frames),
+                features=values
+            ))
+        
+        _lib.file_results_free(results, len(paths))
+        return analyses
             
+# Bump allocator holding the features of one file; reset() releases them all at once.
+# Arrays returned by extract_features are views into the arena: reset() refuses to run while any of them
+# (or a view derived from them) is still alive, copy them first to keep results across files.
+class FeatureArena:
+    def __init__(self, block_size : int = 0) -> None:
+        a = _ffi.new("struct feature_arena **")
+        ErrorHandler.handle_output(_lib.feature_arena_create(block_size, a))
+        self._arena = _ffi.gc(a[0], _lib.feature_arena_free)
+        self._live = 0
+    
+    def _release(self) -> None:
+        self._live -= 1
+    
+    def _view(self, c_values, n_frame : int) -> np.ndarray:
+        if n_frame == 0:
+            return np.empty(0, dtype=np.float32)
+        # Every numpy view holds the buffer, which holds keepalive: its destructor runs once the last view is gone
+        keepalive = _ffi.gc(_ffi.cast("char *", c_values), lambda _p, arena=self: arena._release())
+        self._live += 1
+        return np.frombuffer(_ffi.buffer(keepalive, n_frame*4), dtype=np.float32)
+    
+    def extract_features(self, data : np.ndarray, frame_number : int, frame_length : int, hop_length : int, center : int, features : int = FEATURE_ALL) -> dict[str, np.ndarray]:
+        n_frame = AudiokitInterface.feature_frame_count(frame_number, frame_length, hop_length, center)
+        fs = _ffi.new("struct feature_set *")
+        ErrorHandler.handle_output(_lib.feature_arena_alloc_set(self._arena, features, n_frame, fs))
+        
+        data = _int16_samples(data, "FeatureArena.extract_features")
+        c_data = _ffi.cast('int16_t*', data.ctypes.data)
+        ErrorHandler.handle_output(_lib.extract_features(c_data, frame_number, frame_length, hop_length, center, features, fs))
+        
+        results : dict[str, np.ndarray] = {}
+        for name, flag in (("zcr", FEATURE_ZCR), ("rms", FEATURE_RMS), ("envelope", FEATURE_ENVELOPE)):
+            if features & flag:
+                results[name] = self._view(getattr(fs, name), n_frame)
+        return results
+    
+    # Also reuses the memory for the next extract_features, so earlier arrays must be gone in any case
+    def reset(self) -> None:
+        if self._live > 0:
+            raise RuntimeError(f"FeatureArena.reset: {self._live} array(s) returned by extract_features still alive")
+        _lib.feature_arena_reset(self._arena)
+
+# Incremental ZCR over pushes of arbitrary size, bounded to one frame of memory
+class FeatureStream:
+    def __init__(self, frame_length : int, hop_length : int, center : int) -> None:
+        st = _ffi.new("struct feature_stream **")
+        ErrorHandler.handle_output(_lib.feature_stream_create(frame_length, hop_length, center, st))
+        self._stream = _ffi.gc(st[0], _lib.feature_stream_free)
+
+    @staticmethod
+    def _collect(z, f) -> np.ndarray:
+        return _owned_array(z[0], int(f[0]), np.float32)
+
+    def push(self, data : np.ndarray) -> np.ndarray:
+        data = _int16_samples(data, "FeatureStream.push")
+        z = _ffi.new("float **")
+        f = _ffi.new("size_t *")
+        c_data = _ffi.cast("int16_t*", data.ctypes.data)
+        ErrorHandler.handle_output(_lib.feature_stream_push(self._stream, c_data, len(data), z, f))
+        return FeatureStream._collect(z, f)
+
+    def flush(self) -> np.ndarray:
+        z = _ffi.new("float **")
+        f = _ffi.new("size_t *")
+        ErrorHandler.handle_output(_lib.feature_stream_flush(self._stream, z, f))
+        return FeatureStream._collect(z, f)
+
+class LoudnessMeter:
+    # Streaming EBU R128 meter: loudness in LUFS (-inf below the gates), range in LU, linear peaks
+    def __init__(self, channels : int, sr : int) -> None:
+        m = _ffi.new("struct loudness_meter **")
+        ErrorHandler.handle_output(_lib.loudness_meter_create(channels, sr, m))
+        self._meter = _ffi.gc(m[0], _lib.loudness_meter_free)
+        self.channels = channels
+
+    @staticmethod
+    def _stats_dict(st) -> dict[str, float]:
+        return {name : getattr(st, name) for name in ("integrated", "range", "momentary", "short_term", "momentary_max", "short_term_max", "true_peak", "sample_peak")}
+
+    def push(self, data : np.ndarray) -> None:
+        data = _int16_samples(data, "LoudnessMeter.push")
+        c_data = _ffi.cast("int16_t*", data.ctypes.data)
+        ErrorHandler.handle_output(_lib.loudness_meter_push(self._meter, c_data, data.size // self.channels))
+
+    def stats(self) -> dict[str, float]:
+        st = _ffi.new("struct loudness_stats *")
+        ErrorHandler.handle_output(_lib.loudness_meter_stats(self._meter, st))
+        return LoudnessMeter._stats_dict(st)
+
+    def true_peak(self, channel : int) -> float:
+        p = _ffi.new("double *")
+        ErrorHandler.handle_output(_lib.loudness_meter_true_peak(self._meter, channel, p))
+        return p[0]
+
+# Sample-rate converter over pushes of arbitrary size: the concatenated outputs equal AudiokitInterface.resample
+class Resampler:
+    def __init__(self, channels : int, in_rate : int, out_rate : int, dtype = np.int16) -> None:
+        self.dtype = np.dtype(np.int16 if np.dtype(dtype) == np.int16 else np.float32)
+        rs = _ffi.new("struct resampler **")
+        ErrorHandler.handle_output(_lib.resampler_create(channels, in_rate, out_rate, Resampler._sample_type(self.dtype), rs))
+        self._resampler = _ffi.gc(rs[0], _lib.resampler_free)
+        self.channels = channels
+
+    @staticmethod
+    def _sample_type(dtype) -> int:
+        return _lib.SAMPLE_S16 if dtype == np.int16 else _lib.SAMPLE_F32
+
+    def _collect(self, y, f) -> np.ndarray:
+        return _owned_array(y[0], int(f[0]) * self.channels, self.dtype)
+
+    def push(self, data : np.ndarray) -> np.ndarray:
+        data = np.ascontiguousarray(data, dtype=self.dtype)
+        y = _ffi.new("void **")
+        f = _ffi.new("size_t *")
+        c_data = _ffi.cast("void*", data.ctypes.data)
+        ErrorHandler.handle_output(_lib.resampler_push(self._resampler, c_data, data.size // self.channels, y, f))
+        return self._collect(y, f)
+
+    def flush(self) -> np.ndarray:
+        y = _ffi.new("void **")
+        f = _ffi.new("size_t *")
+        ErrorHandler.handle_output(_lib.resampler_flush(self._resampler, y, f))
+        return self._collect(y, f)
+
 class Audiokit:
     def __init__(self, filename : str = ""):
         
-        wave_data : WaveData = AudiokitInterface.retrieve_wav_data(filename=filename)
+        # The file is held once, planar: one contiguous row per channel
+        wave_data : WaveData = AudiokitInterface.retrieve_wav_data(filename=filename, planar=True)
         
         self.riff   = wave_data.riff
         self.wave   = wave_data.wave
@@ -148,13 +778,49 @@ class Audiokit:
         self.bits_per_sample  = wave_data.bits_per_sample
         self.data_chunk_header = wave_data.data_chunk_header
         self.data_size        = wave_data.data_size
-        self.data = wave_data.data
         self.frame_number = wave_data.frame_number
         self.sample_number = wave_data.sample_number
         self.audio_length_s = wave_data.audio_length_s
+        self.filename = filename
+        self.planar_data = wave_data.data
+    
+    # Interleaved samples (retrieve_wav_data layout), copied from planar_data on each access
+    @property
+    def data(self) -> np.ndarray:
+        return np.ascontiguousarray(self.planar_data.T).reshape(-1)
         
+    # Feature methods return one row per channel: shape (channels, n_frames)
     def zero_crossing_rate(self, frame_length : int, hop_length : int, center : int) -> np.ndarray:
-        return AudiokitInterface.zero_crossing_rate(self.data, self.frame_number, frame_length, hop_length, center)
+        return AudiokitInterface.extract_features_planar(self.planar_data, frame_length, hop_length, center, FEATURE_ZCR)["zcr"]
+    
+    def rms(self, frame_length : int, hop_length : int, center : int) -> np.ndarray:
+        return AudiokitInterface.extract_features_planar(self.planar_data, frame_length, hop_length, center, FEATURE_RMS)["rms"]
+    
+    def amplitude_envelope(self, frame_length : int, hop_length : int, center : int) -> np.ndarray:
+        return AudiokitInterface.extract_features_planar(self.planar_data, frame_length, hop_length, center, FEATURE_ENVELOPE)["envelope"]
+    
+    def extract_features(self, frame_length : int, hop_length : int, center : int, features : int = FEATURE_ALL, pool : ThreadPool | None = None) -> dict[str, np.ndarray]:
+        return AudiokitInterface.extract_features_planar(self.planar_data, frame_length, hop_length, center, features, pool)
+    
+    # Rhythm methods run on the mono mix, at the sample rate of the file: the C downmix (rounded to nearest,
+    # as analyze_files) decodes it straight from the file instead of averaging a float64 copy
+    def _mono(self) -> np.ndarray:
+        if self.channels == 1:
+            return self.planar_data[0]
+        return AudiokitInterface.retrieve_wav_data_channels(self.filename, None)
+    
+    def onset_detect(self, hop_length : int = 512) -> tuple[np.ndarray, np.ndarray]:
+        mono = self._mono()
+        return AudiokitInterface.onset_detect(mono, len(mono), self.sample_rate, hop_length=hop_length)
+    
+    def beat_track(self, hop_length : int = 512) -> tuple[float, np.ndarray, np.ndarray]:
+        mono = self._mono()
+        return AudiokitInterface.beat_track(mono, len(mono), self.sample_rate, hop_length=hop_length)
+    
+    # Planar copy of the file at another sampling rate, shape (channels, frames)
+    def resample(self, sr : int) -> np.ndarray:
+        data = AudiokitInterface.resample(self.data, self.channels, self.sample_rate, sr)
+        return np.ascontiguousarray(data.reshape(-1, self.channels).T)
                 
 if __name__ == "__main__":
     audiokit = Audiokit(FILENAME)
@@ -162,15 +828,18 @@ if __name__ == "__main__":
 
     print(f'audiokit frame number : {audiokit.frame_number}')
     
-    audiokit_zcr = audiokit.zero_crossing_rate(2048, 512, 0)
-    zcr_number = len(audiokit_zcr)
+    # librosa.load resamples to 22050 Hz: features are compared at its rate
+    y, sr = librosa.load(FILENAME, mono=False)
+    resampled = audiokit.resample(sr)
+    audiokit_zcr = AudiokitInterface.extract_features_planar(resampled, 2048, 512, 0, FEATURE_ZCR)["zcr"]
+    zcr_number = audiokit_zcr.shape[1]
 
-    y, sr = librosa.load(FILENAME)
-    librosa_zcr = librosa.feature.zero_crossing_rate(y, frame_length=2048, hop_length=512, center=False)[0]
+    librosa_zcr = librosa.feature.zero_crossing_rate(y, frame_length=2048, hop_length=512, center=False)
+    librosa_zcr = librosa_zcr.reshape(-1, librosa_zcr.shape[-1])
     
     for i in range(10):
-        print(f"zero crossing rate audiokit {i} : {audiokit_zcr[i]}")
-        print(f"zero crossing rate librosa {i} : {librosa_zcr[i]}")
+        print(f"zero crossing rate audiokit {i} : {audiokit_zcr[:, i]}")
+        print(f"zero crossing rate librosa {i} : {librosa_zcr[:, i]}")
 
     # sample_nb_represented : Final[int] = 1000
     # start_born : int = random.randint(0, audiokit.frame_number)
@@ -8,7 +8,7 @@ ffibuilder.cdef("""
     struct wav_header {
         // RIFF chunk descriptor
         char     chunk_id[5];    // "RIFF"
-        uint32_t chunk_size;     // taille fichier - 8
+        uint64_t chunk_size;     // taille fichier - 8 (64 bits pour RF64/BW64)
         char     format[5];      // "WAVE"
 
         // fmt subchunk
@@ -23,7 +23,20 @@ ffibuilder.cdef("""
 
         // data subchunk
         char     subchunk2_id[5]; // "data"
-        uint32_t subchunk2_size;  // nombre d’octets de données
+        uint64_t subchunk2_size;  // nombre d’octets de données (64 bits pour RF64/BW64)
+
+        uint64_t fmt_offset;      // offset du payload "fmt " dans le fichier
+        uint64_t data_offset;     // offset du premier échantillon dans le fichier
+
+        uint16_t sample_format;   // WAVE_FORMAT_PCM ou WAVE_FORMAT_IEEE_FLOAT
+    };
+
+    struct wav_mapping {
+        struct wav_header header;
+        const int16_t *samples;
+        uint64_t frames;
+        void    *map_base;
+        size_t   map_length;
     };
     
     typedef enum {
@@ -35,7 +48,36 @@ ffibuilder.cdef("""
         ERR_INTERNAL
     } ErrorCode;
     
-    int retrieve_wav_data(char *filename, struct wav_header *out_wh, int16_t **out_samples, uint32_t *out_frames);
+    ErrorCode probe_wav_file(const char *filename, struct wav_header *out_wh);
+
+    int retrieve_wav_data(char *filename, struct wav_header *out_wh, int16_t **out_samples, uint64_t *out_frames);
+
+    typedef enum {
+        SAMPLE_S16 = 0,
+        SAMPLE_F32 = 1
+    } SampleType;
+
+    ErrorCode retrieve_wav_data_as(const char *filename, SampleType out_type, struct wav_header *out_wh, void **out_samples, uint64_t *out_frames);
+
+    typedef enum {
+        CHANNELS_ALL = 0,
+        CHANNELS_DOWNMIX,
+        CHANNELS_SELECT
+    } ChannelMode;
+
+    struct channel_selection {
+        ChannelMode mode;
+        const uint16_t *channels;
+        uint16_t n_channels;
+    };
+
+    ErrorCode retrieve_wav_data_channels(const char *filename, SampleType out_type, const struct channel_selection *sel, struct wav_header *out_wh, void **out_samples, uint64_t *out_frames, uint16_t *out_channels);
+
+    ErrorCode retrieve_wav_data_range(const char *filename, SampleType out_type, uint64_t start_frame, uint64_t n_frames, struct wav_header *out_wh, void **out_samples, uint64_t *out_frames);
+
+    ErrorCode retrieve_wav_data_mmap(const char *filename, struct wav_mapping *out_map);
+
+    void release_wav_data_mmap(struct wav_mapping *map);
     
     ErrorCode zero_crossing_rate(
         const int16_t *samples,
@@ -47,17 +89,259 @@ ffibuilder.cdef("""
         size_t *n_frames_out
     );
     
+    ErrorCode amplitude_envelope(
+        const int16_t *samples,
+        size_t N,
+        size_t frame_length,
+        size_t hop_length,
+        int center,
+        float **envelope_out,
+        size_t *n_frames_out
+    );
+
+    ErrorCode rms(
+        const int16_t *samples,
+        size_t N,
+        size_t frame_length,
+        size_t hop_length,
+        int center,
+        float **rms_out,
+        size_t *n_frames_out
+    );
+
+    ErrorCode zero_crossing_rate_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, int center, float **zcr_out, size_t *n_frames_out);
+
+    ErrorCode rms_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, int center, float **rms_out, size_t *n_frames_out);
+
+    ErrorCode amplitude_envelope_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, int center, float **envelope_out, size_t *n_frames_out);
+
+    typedef enum {
+        FEATURE_ZCR      = 1,
+        FEATURE_RMS      = 2,
+        FEATURE_ENVELOPE = 4,
+        FEATURE_ALL      = 7
+    } FeatureFlags;
+
+    struct feature_set {
+        float *zcr;
+        float *rms;
+        float *envelope;
+        size_t n_frames;
+    };
+
+    size_t feature_frame_count(size_t N, size_t frame_length, size_t hop_length, int center);
+
+    ErrorCode extract_features(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, int center, unsigned features, struct feature_set *out);
+
+    ErrorCode zero_crossing_rate_into(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, int center, float *zcr_out, size_t capacity, size_t *n_frames_out);
+
+    ErrorCode rms_into(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, int center, float *rms_out, size_t capacity, size_t *n_frames_out);
+
+    ErrorCode amplitude_envelope_into(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, int center, float *envelope_out, size_t capacity, size_t *n_frames_out);
+
+    struct feature_arena;
+
+    ErrorCode feature_arena_create(size_t block_size, struct feature_arena **out_arena);
+
+    void *feature_arena_alloc(struct feature_arena *arena, size_t bytes);
+
+    ErrorCode feature_arena_alloc_set(struct feature_arena *arena, unsigned features, size_t n_frames, struct feature_set *out);
+
+    void feature_arena_reset(struct feature_arena *arena);
+
+    void feature_arena_free(struct feature_arena *arena);
+
+    struct thread_pool;
+
+    ErrorCode thread_pool_create(size_t n_threads, struct thread_pool **out_pool);
+
+    void thread_pool_free(struct thread_pool *pool);
+
+    size_t thread_pool_size(const struct thread_pool *pool);
+
+    ErrorCode zero_crossing_rate_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, int center, float **zcr_out, size_t *n_frames_out);
+
+    ErrorCode rms_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, int center, float **rms_out, size_t *n_frames_out);
+
+    ErrorCode amplitude_envelope_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, int center, float **envelope_out, size_t *n_frames_out);
+
+    ErrorCode extract_features_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, int center, unsigned features, struct feature_set *out);
+
+    struct feature_spec {
+        unsigned features;
+        size_t frame_length;
+        size_t hop_length;
+        int center;
+    };
+
+    struct file_result {
+        ErrorCode status;
+        const char *message;
+        struct wav_header header;
+        uint64_t frames;
+        struct feature_set features;
+    };
+
+    ErrorCode analyze_files(struct thread_pool *pool, const char *const *paths, size_t n_paths, const struct feature_spec *spec, struct file_result *results);
+
+    void file_results_free(struct file_result *results, size_t n_paths);
+
+    struct planar_audio {
+        int16_t *data;
+        uint16_t channels;
+        uint64_t frames;
+    };
+
+    ErrorCode deinterleave_s16(const int16_t *interleaved, uint64_t frames, uint16_t channels, struct planar_audio *out);
+
+    ErrorCode retrieve_wav_data_planar(const char *filename, struct wav_header *out_wh, struct planar_audio *out);
+
+    void planar_audio_free(struct planar_audio *audio);
+
+    ErrorCode extract_features_planar(struct thread_pool *pool, const struct planar_audio *audio, size_t frame_length, size_t hop_length, int center, unsigned features, struct feature_set *out);
+
+    struct zcr_prefix;
+
+    ErrorCode zcr_prefix_build(const int16_t *samples, size_t N, struct zcr_prefix **out_prefix);
+
+    ErrorCode zero_crossing_rate_prefix(const struct zcr_prefix *prefix, size_t frame_length, size_t hop_length, int center, float **zcr_out, size_t *n_frames_out);
+
+    void zcr_prefix_free(struct zcr_prefix *prefix);
+
+    struct feature_stream;
+
+    ErrorCode feature_stream_create(size_t frame_length, size_t hop_length, int center, struct feature_stream **out_stream);
+
+    ErrorCode feature_stream_push(struct feature_stream *st, const int16_t *samples, size_t n, float **zcr_out, size_t *n_frames_out);
+
+    ErrorCode feature_stream_flush(struct feature_stream *st, float **zcr_out, size_t *n_frames_out);
+
+    void feature_stream_free(struct feature_stream *st);
+
+    typedef enum {
+        WINDOW_HANN = 0,
+        WINDOW_HAMMING,
+        WINDOW_RECTANGULAR
+    } WindowType;
+
+    ErrorCode rfft(const float *x, size_t n, float *spectrum_out);
+
+    ErrorCode irfft(const float *spectrum, size_t n, float *x_out);
+
+    void fft_plan_cache_clear(void);
+
+    ErrorCode stft(const int16_t *samples, size_t N, size_t n_fft, size_t hop_length, int center, WindowType window, float **spectrum_out, size_t *n_bins_out, size_t *n_frames_out);
+
+    ErrorCode stft_magnitude(const int16_t *samples, size_t N, size_t n_fft, size_t hop_length, int center, WindowType window, float power, float **magnitude_out, size_t *n_bins_out, size_t *n_frames_out);
+
+    ErrorCode istft(const float *spectrum, size_t n_fft, size_t n_frames, size_t hop_length, int center, WindowType window, size_t length, float **signal_out, size_t *n_out);
+
+    struct mel_params {
+        uint32_t sample_rate;
+        size_t n_fft;
+        size_t hop_length;
+        int center;
+        WindowType window;
+        float power;
+        size_t n_mels;
+        float fmin;
+        float fmax;
+    };
+
+    void mel_params_default(struct mel_params *p, uint32_t sample_rate);
+
+    ErrorCode mel_filterbank(const struct mel_params *p, float **weights_out);
+
+    ErrorCode mel_spectrogram(const int16_t *samples, size_t N, const struct mel_params *p, float **mel_out, size_t *n_frames_out);
+
+    ErrorCode mfcc(const int16_t *samples, size_t N, const struct mel_params *p, size_t n_mfcc, float **mfcc_out, size_t *n_frames_out);
+
+    ErrorCode spectral_features(const int16_t *samples, size_t N, uint32_t sample_rate, size_t n_fft, size_t hop_length, int center, WindowType window, float roll_percent, float **centroid_out, float **bandwidth_out, float **rolloff_out, float **flatness_out, float **flux_out, size_t *n_frames_out);
+
+    ErrorCode spectral_features_from_magnitude(const float *magnitude, size_t n_bins, size_t n_frames, uint32_t sample_rate, float roll_percent, float **centroid_out, float **bandwidth_out, float **rolloff_out, float **flatness_out, float **flux_out, size_t *n_frames_out);
+
+    ErrorCode yin(const int16_t *samples, size_t N, uint32_t sample_rate, size_t frame_length, size_t hop_length, int center, float fmin, float fmax, float trough_threshold, float **f0_out, size_t *n_frames_out);
+
+    struct loudness_stats {
+        double integrated;
+        double range;
+        double momentary;
+        double short_term;
+        double momentary_max;
+        double short_term_max;
+        double true_peak;
+        double sample_peak;
+    };
+
+    struct loudness_meter;
+
+    ErrorCode loudness_meter_create(uint16_t channels, uint32_t sample_rate, struct loudness_meter **out_meter);
+
+    ErrorCode loudness_meter_push(struct loudness_meter *m, const int16_t *samples, size_t frames);
+
+    ErrorCode loudness_meter_stats(const struct loudness_meter *m, struct loudness_stats *out);
+
+    ErrorCode loudness_meter_true_peak(const struct loudness_meter *m, uint16_t channel, double *out_peak);
+
+    void loudness_meter_free(struct loudness_meter *m);
+
+    ErrorCode loudness_measure(const int16_t *samples, uint64_t frames, uint16_t channels, uint32_t sample_rate, struct loudness_stats *out);
+
+    struct audio_region {
+        uint64_t start;
+        uint64_t end;
+    };
+
+    ErrorCode trim_silence(const int16_t *samples, uint64_t frames, uint16_t channels, float threshold_db, size_t block_length, uint64_t *start_out, uint64_t *end_out);
+
+    ErrorCode split_silence(const int16_t *samples, uint64_t frames, uint16_t channels, float threshold_db, size_t block_length, uint64_t min_silence, uint64_t min_region, struct audio_region **regions_out, size_t *n_regions_out);
+
+    struct onset_params {
+        size_t pre_max;
+        size_t post_max;
+        size_t pre_avg;
+        size_t post_avg;
+        size_t wait;
+        float delta;
+    };
+
+    ErrorCode onset_strength(const int16_t *samples, size_t N, const struct mel_params *p, float **onset_out, size_t *n_frames_out);
+
+    void onset_params_default(struct onset_params *op, uint32_t sample_rate, size_t hop_length);
+
+    ErrorCode onset_detect(const int16_t *samples, size_t N, const struct mel_params *p, const struct onset_params *op, size_t **frames_out, float **times_out, size_t *n_onsets_out);
+
+    ErrorCode beat_track(const int16_t *samples, size_t N, const struct mel_params *p, float start_bpm, float tightness, double *tempo_out, size_t **frames_out, float **times_out, size_t *n_beats_out);
+
+    struct resampler;
+
+    ErrorCode resampler_create(uint16_t channels, uint32_t in_rate, uint32_t out_rate, SampleType type, struct resampler **out_resampler);
+
+    ErrorCode resampler_push(struct resampler *rs, const void *samples, size_t frames, void **out_samples, size_t *out_frames);
+
+    ErrorCode resampler_flush(struct resampler *rs, void **out_samples, size_t *out_frames);
+
+    void resampler_free(struct resampler *rs);
+
+    ErrorCode resample(const void *samples, size_t frames, uint16_t channels, SampleType type, uint32_t in_rate, uint32_t out_rate, void **out_samples, size_t *out_frames);
+
+    void free(void *ptr);
+
     ErrorCode last_error_code(void);
 
     const char *last_error_message(void);
 """)
 
+# Mode API (set_source) : cffi relâche le GIL pendant chaque appel C. La bibliothèque étant réentrante
+# (aucun état global mutable, erreurs par thread), des threads Python peuvent l'appeler en parallèle.
+
 # 2) Compilation de tes SOURCES .c (pas d'archive .a)
 ffibuilder.set_source(
     "_audiokit",                     # nom du module Python généré
     '#include "audiokit_cffi.h"',    # petite “glue” C : inclut header public allégé
     sources=["../src/audiokit.c"],      # <-- on compile directement tes .c en PIC
     include_dirs=["../src/"],            
+    libraries=["m", "pthread"],      # sqrt/log... et pthread_once pour le dispatch SIMD
     # library_dirs=[...],            # si besoin de dossiers spéciaux pour ces libs externes
 )
 
@@ -2,326 +2,6233 @@
  * Read and parse a wave file
  *
  **/
+// off_t 64 bits : fichiers de plus de 2 Go sur les plateformes 32 bits
+#define _FILE_OFFSET_BITS 64
+
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <math.h>
+#include <float.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
 #include "audiokit.h"
 
-#define TRUE 1
-#define FALSE 0
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AUDIOKIT_X86 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIOKIT_NEON 1
+#endif
+
+#define TRUE 1
+#define FALSE 0
+
+// The library keeps no mutable global state: every call works on its own FILE and buffers, errors are
+// per thread and the only shared tables are the SIMD dispatch (initialized once through pthread_once)
+// and the FFT plan, mel filterbank and resampling filter caches (immutable entries, lists protected by a mutex).
+// Any function may be called concurrently from several threads on different objects.
+static _Thread_local ErrorContext last_error = {ERR_OK, NULL};
+
+// ########################################## HELPERS ##########################################
+
+// Per-frame statistics accumulated by the fused kernel
+struct frame_stats {
+    uint64_t crossings;
+    uint64_t sumsq;
+    int peak;
+};
+
+// Table of the kernels selected at runtime for the running CPU (scalar, SSE2, AVX2 or NEON)
+struct simd_kernels {
+    size_t (*zcr_count_i16)(const int16_t *x, size_t n);
+    uint64_t (*sumsq_i16)(const int16_t *x, size_t n);
+    void (*frame_stats_i16)(const int16_t *x, size_t n, struct frame_stats *st);
+    // sample conversions, src is little-endian and may be unaligned
+    void (*s16_to_f32)(const unsigned char *src, size_t n, float *dst);
+    void (*s24_to_f32)(const unsigned char *src, size_t n, float *dst);
+    void (*f32_to_s16)(const unsigned char *src, size_t n, int16_t *dst);
+    // stereo frames to two contiguous channels
+    void (*deinterleave2_i16)(const int16_t *x, size_t n, int16_t *left, int16_t *right);
+    // FIR filters (true-peak interpolation, resampling), summed in 8 lanes folded in a fixed order
+    float (*dot_f32)(const float *a, const float *b, size_t n);
+};
+
+static const struct simd_kernels *kernels(void);
+
+static inline int sgn_i16(int16_t x);
+
+static size_t zcr_count(const int16_t *x, size_t n);
+
+static size_t frame_count(size_t N, size_t frame_length, size_t hop_length, int center);
+
+static inline float zcr_from_count(size_t count, size_t frame_length);
+
+static struct mel_bank *mel_bank_free(struct mel_bank *bank);
+
+static void resample_cache_prune(void);
+
+// ########################################## ERROR HANDLERS ##########################################
+
+static void set_error(ErrorCode code, const char *msg)
+{
+    last_error.code = code;
+    last_error.msg = msg;
+}
+
+ErrorCode last_error_code(void)
+{
+    return last_error.code;
+}
+
+const char *last_error_message(void)
+{
+    return last_error.msg ? last_error.msg : "";
+}
+
+// ########################################## RIFF PARSING ##########################################
+
+// One RIFF chunk: id, declared payload size and offset of the payload in the file
+struct riff_chunk {
+    char     id[5];
+    uint64_t size;            // 32 bits dans le fichier, 64 bits via ds64 pour le data chunk RF64
+    uint64_t offset;
+};
+
+static uint16_t read_le16(const unsigned char *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_le32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Reads the chunk header (id + size) at the current position of fp, which is left at the payload
+ * @param fp A pointer to a RIFF file positioned on a chunk boundary
+ * @param chunk Receives the chunk id, payload size and payload offset
+ * @return ERR_OK, or ERR_IO when no complete chunk header is left
+ */
+static ErrorCode riff_read_chunk(FILE *fp, struct riff_chunk *chunk)
+{
+    unsigned char raw[8];
+    if (fread(raw, 1, sizeof raw, fp) != sizeof raw)
+        return ERR_IO;
+
+    memcpy(chunk->id, raw, 4);
+    chunk->id[4] = '\0';
+    chunk->size = read_le32(raw + 4);
+    off_t pos = ftello(fp);
+    if (pos < 0)
+        return ERR_IO;
+    chunk->offset = (uint64_t)pos;
+    return ERR_OK;
+}
+
+// Moves fp to the header of the chunk following chunk (payloads are padded to an even size)
+static ErrorCode riff_skip_chunk(FILE *fp, const struct riff_chunk *chunk)
+{
+    uint64_t next = chunk->offset + chunk->size + (chunk->size & 1u);
+    return fseeko(fp, (off_t)next, SEEK_SET) == 0 ? ERR_OK : ERR_IO;
+}
+
+// Reads the ds64 chunk that must follow the RF64/BW64 header: 64-bit RIFF and data sizes
+static ErrorCode parse_ds64_chunk(FILE *fp, uint64_t *riff_size, uint64_t *data_size)
+{
+    struct riff_chunk chunk;
+    unsigned char raw[16];
+    if (riff_read_chunk(fp, &chunk) != ERR_OK || memcmp(chunk.id, "ds64", 4) != 0 ||
+        chunk.size < sizeof raw || fread(raw, 1, sizeof raw, fp) != sizeof raw)
+        return ERR_FORMAT;
+
+    *riff_size = (uint64_t)read_le32(raw) | ((uint64_t)read_le32(raw + 4) << 32);
+    *data_size = (uint64_t)read_le32(raw + 8) | ((uint64_t)read_le32(raw + 12) << 32);
+    return riff_skip_chunk(fp, &chunk);
+}
+
+// Decodes a "fmt " chunk payload into hdr
+static ErrorCode parse_fmt_chunk(FILE *fp, const struct riff_chunk *chunk, struct wav_header *hdr)
+{
+    unsigned char raw[16];
+    if (chunk->size < sizeof raw || fread(raw, 1, sizeof raw, fp) != sizeof raw)
+        return ERR_FORMAT;
+
+    memcpy(hdr->subchunk1_id, chunk->id, 5);
+    hdr->subchunk1_size = chunk->size;
+    hdr->audio_format = read_le16(raw);
+    hdr->num_channels = read_le16(raw + 2);
+    hdr->sample_rate = read_le32(raw + 4);
+    hdr->byte_rate = read_le32(raw + 8);
+    hdr->block_align = read_le16(raw + 12);
+    hdr->bits_per_sample = read_le16(raw + 14);
+    hdr->fmt_offset = chunk->offset;
+    hdr->sample_format = hdr->audio_format;
+
+    // WAVE_FORMAT_EXTENSIBLE : cbSize, wValidBitsPerSample, dwChannelMask puis le GUID SubFormat,
+    // dont les deux premiers octets sont le code de format effectif (PCM, IEEE float)
+    if (hdr->audio_format == WAVE_FORMAT_EXTENSIBLE)
+    {
+        unsigned char ext[10];
+        if (chunk->size < 16 + sizeof ext || fread(ext, 1, sizeof ext, fp) != sizeof ext)
+            return ERR_FORMAT;
+        hdr->sample_format = read_le16(ext + 8);
+    }
+    return ERR_OK;
+}
+
+/**
+ * Parses the header of a WAV file by walking its RIFF chunks: unknown chunks (LIST, fact, cue, bext,
+ * JUNK...) are skipped whatever their position, and the byte offsets of the fmt and data payloads are
+ * recorded. No sample is read: on success fp is positioned at the first byte of the data chunk.
+ * A data chunk declaring more bytes than the file holds (unfinished recordings) is clamped to the file.
+ * @param fp A pointer to a WAV file, positioned at its start
+ * @param out_wh Receives the parsed header
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode parse_wav_header(FILE *fp, struct wav_header *out_wh)
+{
+    if (!fp || !out_wh)
+    {
+        set_error(ERR_INVALID_ARG, "parse_wav_header: null argument");
+        return ERR_INVALID_ARG;
+    }
+
+    struct wav_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+
+    // RIFF
+    unsigned char riff[12];
+    if (fread(riff, 1, sizeof riff, fp) != sizeof riff)
+    {
+        set_error(ERR_IO, "parse_wav_header: file too short");
+        return ERR_IO;
+    }
+    memcpy(hdr.chunk_id, riff, 4);
+    hdr.chunk_size = read_le32(riff + 4);
+    memcpy(hdr.format, riff + 8, 4);
+    // RF64 (EBU Tech 3306) et BW64 (ITU-R BS.2088) : tailles 64 bits dans un chunk ds64
+    int is_rf64 = memcmp(hdr.chunk_id, "RF64", 4) == 0 || memcmp(hdr.chunk_id, "BW64", 4) == 0;
+    if ((memcmp(hdr.chunk_id, "RIFF", 4) != 0 && !is_rf64) || memcmp(hdr.format, "WAVE", 4) != 0)
+    {
+        *out_wh = hdr;
+        set_error(ERR_FORMAT, "parse_wav_header: not a RIFF/WAVE file");
+        return ERR_FORMAT;
+    }
+
+    uint64_t ds64_data_size = 0;
+    if (is_rf64 && parse_ds64_chunk(fp, &hdr.chunk_size, &ds64_data_size) != ERR_OK)
+    {
+        *out_wh = hdr;
+        set_error(ERR_FORMAT, "parse_wav_header: RF64 file without a valid ds64 chunk");
+        return ERR_FORMAT;
+    }
+
+    struct stat st;
+    uint64_t file_size = fstat(fileno(fp), &st) == 0 ? (uint64_t)st.st_size : UINT64_MAX;
+
+    int have_fmt = FALSE, have_data = FALSE, truncated = FALSE;
+    struct riff_chunk chunk;
+    while (!(have_fmt && have_data))
+    {
+        if (riff_read_chunk(fp, &chunk) != ERR_OK)
+            break;
+        // En RF64, la taille 32 bits du data chunk vaut 0xFFFFFFFF : la vraie taille est dans ds64
+        if (is_rf64 && chunk.size == UINT32_MAX && memcmp(chunk.id, "data", 4) == 0)
+            chunk.size = ds64_data_size;
+
+        if (memcmp(chunk.id, "fmt ", 4) == 0)
+        {
+            if (parse_fmt_chunk(fp, &chunk, &hdr) != ERR_OK)
+            {
+                *out_wh = hdr;
+                set_error(ERR_FORMAT, "parse_wav_header: truncated fmt chunk");
+                return ERR_FORMAT;
+            }
+            have_fmt = TRUE;
+        }
+        else if (memcmp(chunk.id, "data", 4) == 0)
+        {
+            memcpy(hdr.subchunk2_id, chunk.id, 5);
+            hdr.subchunk2_size = chunk.size;
+            if (chunk.offset + chunk.size > file_size)
+            {
+                hdr.subchunk2_size = file_size - chunk.offset;
+                truncated = TRUE;
+            }
+            hdr.data_offset = chunk.offset;
+            have_data = TRUE;
+            // Le data chunk est en général le dernier : inutile de le sauter si fmt est déjà lu
+            if (have_fmt)
+                break;
+        }
+
+        if (riff_skip_chunk(fp, &chunk) != ERR_OK)
+            break;
+    }
+
+    *out_wh = hdr;
+    if (!have_fmt || !have_data)
+    {
+        set_error(ERR_FORMAT, have_fmt ? "parse_wav_header: no data chunk" : "parse_wav_header: no fmt chunk");
+        return ERR_FORMAT;
+    }
+    // Un enregistrement interrompu peut finir au milieu d'une frame : on ne garde que les frames complètes
+    if (truncated && hdr.block_align > 0)
+        hdr.subchunk2_size -= hdr.subchunk2_size % hdr.block_align;
+    *out_wh = hdr;
+
+    if (fseeko(fp, (off_t)hdr.data_offset, SEEK_SET) != 0)
+    {
+        set_error(ERR_IO, "parse_wav_header: cannot seek to data chunk");
+        return ERR_IO;
+    }
+    return ERR_OK;
+}
+
+/**
+ * Reads the complete WAV header (RIFF + fmt + data)
+ * @param fp A pointer to a WAV file
+ * @return a struct representing the WAV header (fields of missing chunks are left to zero,
+ *         see parse_wav_header for error reporting)
+ */
+struct wav_header read_wav_header(FILE *fp)
+{
+    struct wav_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    parse_wav_header(fp, &hdr);
+    return hdr;
+}
+
+/**
+ * Reads only the header of a WAV file, without touching its samples
+ * @param filename Path of the WAV file
+ * @param out_wh Receives the parsed header, including the fmt/data payload offsets
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode probe_wav_file(const char *filename, struct wav_header *out_wh)
+{
+    if (!filename || !out_wh)
+    {
+        set_error(ERR_INVALID_ARG, "probe_wav_file: null argument");
+        return ERR_INVALID_ARG;
+    }
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        set_error(ERR_IO, "probe_wav_file: cannot open file");
+        return ERR_IO;
+    }
+    ErrorCode rc = parse_wav_header(fp, out_wh);
+    fclose(fp);
+    return rc;
+}
+
+// ########################################## LOADING ##########################################
+
+// Number of bytes of one sample of a supported (sample_format, bits_per_sample) pair, 0 if unsupported
+static size_t sample_size(uint16_t sample_format, uint16_t bits_per_sample)
+{
+    if (sample_format == WAVE_FORMAT_PCM &&
+        (bits_per_sample == 8 || bits_per_sample == 16 || bits_per_sample == 24 || bits_per_sample == 32))
+        return bits_per_sample / 8;
+    if (sample_format == WAVE_FORMAT_IEEE_FLOAT && (bits_per_sample == 32 || bits_per_sample == 64))
+        return bits_per_sample / 8;
+    return 0;
+}
+
+// Float to int16 rounding shared by every converter: clamp to [-1, 1] (NaN -> -1), scale, round to nearest even
+static inline int16_t f32_sample_to_s16(float v)
+{
+    v = v > -1.0f ? v : -1.0f;
+    v = v < 1.0f ? v : 1.0f;
+    long r = lrintf(v * 32768.0f);
+    return (int16_t)(r > INT16_MAX ? INT16_MAX : r);
+}
+
+/**
+ * Converts n little-endian samples of the given format into int16 (out_type == SAMPLE_S16) or float32
+ * in [-1, 1) (out_type == SAMPLE_F32). Integer samples are scaled by powers of two, so conversions to
+ * float are exact; narrowing integer conversions keep the most significant bits.
+ */
+static void convert_samples(const unsigned char *src, size_t n, uint16_t sample_format, uint16_t bits_per_sample,
+                            SampleType out_type, void *dst)
+{
+    const struct simd_kernels *k = kernels();
+
+    if (out_type == SAMPLE_S16)
+    {
+        int16_t *out = dst;
+        if (sample_format == WAVE_FORMAT_IEEE_FLOAT && bits_per_sample == 32)
+            k->f32_to_s16(src, n, out);
+        else if (sample_format == WAVE_FORMAT_IEEE_FLOAT)
+            for (size_t i = 0; i < n; ++i)
+            {
+                uint64_t u = (uint64_t)read_le32(src + 8 * i) | ((uint64_t)read_le32(src + 8 * i + 4) << 32);
+                double d;
+                memcpy(&d, &u, sizeof d);
+                out[i] = f32_sample_to_s16((float)d);
+            }
+        else if (bits_per_sample == 8)
+            for (size_t i = 0; i < n; ++i)
+                out[i] = (int16_t)(((int)src[i] - 128) * 256);
+        else if (bits_per_sample == 16)
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            memcpy(out, src, n * sizeof *out);
+#else
+            for (size_t i = 0; i < n; ++i)
+                out[i] = (int16_t)read_le16(src + 2 * i);
+#endif
+        }
+        else if (bits_per_sample == 24)
+            // Les deux octets de poids fort
+            for (size_t i = 0; i < n; ++i)
+                out[i] = (int16_t)read_le16(src + 3 * i + 1);
+        else
+            for (size_t i = 0; i < n; ++i)
+                out[i] = (int16_t)read_le16(src + 4 * i + 2);
+        return;
+    }
+
+    float *out = dst;
+    if (sample_format == WAVE_FORMAT_IEEE_FLOAT && bits_per_sample == 32)
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(out, src, n * sizeof *out);
+#else
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint32_t u = read_le32(src + 4 * i);
+            memcpy(&out[i], &u, sizeof u);
+        }
+#endif
+    }
+    else if (sample_format == WAVE_FORMAT_IEEE_FLOAT)
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint64_t u = (uint64_t)read_le32(src + 8 * i) | ((uint64_t)read_le32(src + 8 * i + 4) << 32);
+            double d;
+            memcpy(&d, &u, sizeof d);
+            out[i] = (float)d;
+        }
+    else if (bits_per_sample == 8)
+        for (size_t i = 0; i < n; ++i)
+            out[i] = (float)((int)src[i] - 128) * (1.0f / 128.0f);
+    else if (bits_per_sample == 16)
+        k->s16_to_f32(src, n, out);
+    else if (bits_per_sample == 24)
+        k->s24_to_f32(src, n, out);
+    else
+        for (size_t i = 0; i < n; ++i)
+            out[i] = (float)(int32_t)read_le32(src + 4 * i) * (1.0f / 2147483648.0f);
+}
+
+// Mean of the channels of each frame, rounded to nearest
+static void downmix_s16(const int16_t *interleaved, size_t frames, size_t channels, int16_t *out)
+{
+    // Cas stéréo sans boucle interne, que le compilateur vectorise
+    if (channels == 2)
+    {
+        for (size_t f = 0; f < frames; ++f)
+        {
+            int32_t acc = (int32_t)interleaved[2 * f] + interleaved[2 * f + 1];
+            out[f] = (int16_t)(acc >= 0 ? (acc + 1) / 2 : (acc - 1) / 2);
+        }
+        return;
+    }
+
+    for (size_t f = 0; f < frames; ++f)
+    {
+        int64_t acc = 0;
+        for (size_t ch = 0; ch < channels; ++ch)
+            acc += interleaved[f * channels + ch];
+        out[f] = (int16_t)(acc >= 0 ? (acc + (int64_t)channels / 2) / (int64_t)channels
+                                    : (acc - (int64_t)channels / 2) / (int64_t)channels);
+    }
+}
+// Mean of the channels of each frame in float
+static void downmix_f32(const float *interleaved, size_t frames, size_t channels, float *out)
+{
+    const float scale = 1.0f / (float)channels;
+    for (size_t f = 0; f < frames; ++f)
+    {
+        float acc = 0.0f;
+        for (size_t ch = 0; ch < channels; ++ch)
+            acc += interleaved[f * channels + ch];
+        out[f] = acc * scale;
+    }
+}
+
+// Folds frames of converted interleaved samples into the reduced layout requested by sel
+static void fold_channels(const unsigned char *src, size_t frames, uint16_t channels, SampleType out_type,
+                          const struct channel_selection *sel, unsigned char *dst)
+{
+    if (sel->mode == CHANNELS_DOWNMIX)
+    {
+        if (out_type == SAMPLE_S16)
+            downmix_s16((const int16_t *)src, frames, channels, (int16_t *)dst);
+        else
+            downmix_f32((const float *)src, frames, channels, (float *)dst);
+        return;
+    }
+
+    // CHANNELS_SELECT : les canaux choisis, dans l'ordre demandé, restent entrelacés
+    const size_t size = out_type == SAMPLE_S16 ? sizeof(int16_t) : sizeof(float);
+    for (size_t f = 0; f < frames; ++f)
+        for (uint16_t k = 0; k < sel->n_channels; ++k)
+            memcpy(dst + (f * sel->n_channels + k) * size, src + (f * channels + sel->channels[k]) * size, size);
+}
+
+/**
+ * Reads the data chunk at the current position of fp, converts every sample to out_type and folds the
+ * channels as requested by sel while decoding, so only the reduced buffer is ever allocated.
+ * Supports 8/16/24/32-bit PCM and 32/64-bit IEEE float, including WAVE_FORMAT_EXTENSIBLE files.
+ * @param fp A pointer to a WAV file positioned on its first sample (see parse_wav_header)
+ * @param hdr The parsed header of the file
+ * @param out_type SAMPLE_S16 or SAMPLE_F32
+ * @param sel Channels to keep (NULL or CHANNELS_ALL keeps them all, CHANNELS_DOWNMIX averages them
+ *            into one, CHANNELS_SELECT keeps sel->channels in that order)
+ * @param out_samples Receives a malloc'ed buffer of out_frames * out_channels interleaved samples
+ * @param out_frames Receives the number of frames
+ * @param out_channels Receives the number of channels of out_samples (may be NULL)
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode read_and_convert_data_channels(FILE *fp, const struct wav_header *hdr, SampleType out_type,
+                                         const struct channel_selection *sel, void **out_samples,
+                                         uint64_t *out_frames, uint16_t *out_channels)
+{
+    if (!fp || !hdr || !out_samples || !out_frames || (out_type != SAMPLE_S16 && out_type != SAMPLE_F32))
+    {
+        set_error(ERR_INVALID_ARG, "read_and_convert_data_channels: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    const size_t bytes_per_sample = sample_size(hdr->sample_format, hdr->bits_per_sample);
+    if (bytes_per_sample == 0)
+    {
+        set_error(ERR_FORMAT, "read_and_convert_data_channels: unsupported sample format");
+        return ERR_FORMAT;
+    }
+    if (hdr->num_channels == 0 || hdr->block_align != hdr->num_channels * bytes_per_sample)
+    {
+        set_error(ERR_FORMAT, "read_and_convert_data_channels: block_align does not match the sample format");
+        return ERR_FORMAT;
+    }
+
+    const uint16_t channels = hdr->num_channels;
+    const uint16_t bytes_per_frame = hdr->block_align;
+    const uint64_t data_size = hdr->subchunk2_size;
+    const size_t out_size = out_type == SAMPLE_S16 ? sizeof(int16_t) : sizeof(float);
+
+    if (data_size == 0 || (data_size % bytes_per_frame) != 0)
+    {
+        set_error(ERR_FORMAT, "read_and_convert_data_channels: data chunk is empty or not a whole number of frames");
+        return ERR_FORMAT;
+    }
+
+    // Canaux de sortie
+    int fold = sel && sel->mode != CHANNELS_ALL;
+    uint16_t kept = channels;
+    if (fold && sel->mode == CHANNELS_DOWNMIX)
+        kept = 1;
+    else if (fold)
+    {
+        if (sel->mode != CHANNELS_SELECT || sel->n_channels == 0 || !sel->channels)
+        {
+            set_error(ERR_INVALID_ARG, "read_and_convert_data_channels: invalid channel selection");
+            return ERR_INVALID_ARG;
+        }
+        for (uint16_t k = 0; k < sel->n_channels; ++k)
+            if (sel->channels[k] >= channels)
+            {
+                set_error(ERR_INVALID_ARG, "read_and_convert_data_channels: selected channel out of range");
+                return ERR_INVALID_ARG;
+            }
+        kept = sel->n_channels;
+    }
+
+    const uint64_t frames = data_size / bytes_per_frame;
+    // Sur une plateforme 32 bits, un fichier RF64 peut dépasser l'espace d'adressage
+    if (frames > SIZE_MAX / out_size / kept)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "read_and_convert_data_channels: data chunk does not fit in memory");
+        return ERR_OUT_OF_MEMORY;
+    }
+    const size_t total_samples = (size_t)frames * (size_t)kept;
+
+    unsigned char *dst = malloc(total_samples * out_size);
+
+    // Lecture par blocs pour éviter un énorme buffer temporaire
+    // Taille cible ~64 KiB, ajustée pour tomber sur un nombre entier de frames
+    size_t target_bytes = 64 * 1024;
+    size_t frames_per_chunk = target_bytes / bytes_per_frame;
+    if (frames_per_chunk == 0)
+        frames_per_chunk = 1;
+    size_t chunk_bytes = frames_per_chunk * (size_t)bytes_per_frame;
+
+    unsigned char *chunk = malloc(chunk_bytes);
+    // Bloc converti avant repliement des canaux, seulement si l'on en replie
+    unsigned char *scratch = fold ? malloc(frames_per_chunk * channels * out_size) : NULL;
+    if (!dst || !chunk || (fold && !scratch))
+    {
+        free(dst);
+        free(chunk);
+        free(scratch);
+        set_error(ERR_OUT_OF_MEMORY, "read_and_convert_data_channels: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    uint64_t frames_done = 0;
+    size_t out_idx = 0;
+
+    while (frames_done < frames)
+    {
+        uint64_t remaining = frames - frames_done;
+        size_t this_frames = remaining < frames_per_chunk ? (size_t)remaining : frames_per_chunk;
+        size_t this_bytes = this_frames * (size_t)bytes_per_frame;
+
+        size_t got = fread(chunk, 1, this_bytes, fp);
+        if (got != this_bytes)
+        {
+            free(chunk);
+            free(scratch);
+            free(dst);
+            set_error(ERR_IO, "read_and_convert_data_channels: short read in data chunk");
+            return ERR_IO;
+        }
+
+        // Convertir ce bloc, directement dans la sortie quand on garde tous les canaux
+        size_t this_samples = this_frames * channels;
+        if (fold)
+        {
+            convert_samples(chunk, this_samples, hdr->sample_format, hdr->bits_per_sample, out_type, scratch);
+            fold_channels(scratch, this_frames, channels, out_type, sel, dst + out_idx * out_size);
+        }
+        else
+            convert_samples(chunk, this_samples, hdr->sample_format, hdr->bits_per_sample, out_type, dst + out_idx * out_size);
+        out_idx += this_frames * kept;
+        frames_done += this_frames;
+    }
+
+    free(chunk);
+    free(scratch);
+
+    // Sorties
+    *out_samples = dst;
+    *out_frames = frames;
+    if (out_channels)
+        *out_channels = kept;
+    return ERR_OK;
+}
+
+/**
+ * Reads the data chunk at the current position of fp and converts every sample to out_type,
+ * keeping all channels (see read_and_convert_data_channels)
+ * @param fp A pointer to a WAV file positioned on its first sample (see parse_wav_header)
+ * @param hdr The parsed header of the file
+ * @param out_type SAMPLE_S16 or SAMPLE_F32
+ * @param out_samples Receives a malloc'ed buffer of out_frames * num_channels interleaved samples
+ * @param out_frames Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode read_and_convert_data(FILE *fp, const struct wav_header *hdr, SampleType out_type,
+                                void **out_samples, uint64_t *out_frames)
+{
+    return read_and_convert_data_channels(fp, hdr, out_type, NULL, out_samples, out_frames, NULL);
+}
+
+
+int read_and_convert_data_s16le(FILE *fp,
+                                const struct wav_header *hdr,
+                                int16_t **out_samples,
+                                uint64_t *out_frames)
+{
+    if (!fp || !hdr || !out_samples || !out_frames)
+        return -1;
+
+    void *samples = NULL;
+    switch (read_and_convert_data(fp, hdr, SAMPLE_S16, &samples, out_frames))
+    {
+    case ERR_OK:
+        *out_samples = samples;
+        return 0;
+    case ERR_FORMAT:
+        return -2; // format non supporté
+    case ERR_OUT_OF_MEMORY:
+        return -7;
+    default:
+        return -9; // lecture incomplète/erreur
+    }
+}
+
+/**
+ * Loads a WAV file of any supported sample format, converted to out_type
+ * @param filename Path of the WAV file
+ * @param out_type SAMPLE_S16 or SAMPLE_F32
+ * @param out_wh Receives the parsed header
+ * @param out_samples Receives a malloc'ed buffer of out_frames * num_channels interleaved samples
+ * @param out_frames Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode retrieve_wav_data_as(const char *filename, SampleType out_type, struct wav_header *out_wh,
+                               void **out_samples, uint64_t *out_frames)
+{
+    if (!filename || !out_wh)
+    {
+        set_error(ERR_INVALID_ARG, "retrieve_wav_data_as: null argument");
+        return ERR_INVALID_ARG;
+    }
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        set_error(ERR_IO, "retrieve_wav_data_as: cannot open file");
+        return ERR_IO;
+    }
+
+    ErrorCode rc = parse_wav_header(fp, out_wh);
+    if (rc == ERR_OK)
+        rc = read_and_convert_data(fp, out_wh, out_type, out_samples, out_frames);
+    fclose(fp);
+    return rc;
+}
+
+/**
+ * Loads a WAV file converted to out_type, folding its channels during decode (see
+ * read_and_convert_data_channels). With CHANNELS_DOWNMIX an 8-channel file only ever allocates its mono mix.
+ * @param filename Path of the WAV file
+ * @param out_type SAMPLE_S16 or SAMPLE_F32
+ * @param sel Channels to keep, NULL keeps them all
+ * @param out_wh Receives the parsed header (num_channels is the one of the file)
+ * @param out_samples Receives a malloc'ed buffer of out_frames * out_channels interleaved samples
+ * @param out_frames Receives the number of frames
+ * @param out_channels Receives the number of channels of out_samples (may be NULL)
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode retrieve_wav_data_channels(const char *filename, SampleType out_type, const struct channel_selection *sel,
+                                     struct wav_header *out_wh, void **out_samples, uint64_t *out_frames,
+                                     uint16_t *out_channels)
+{
+    if (!filename || !out_wh)
+    {
+        set_error(ERR_INVALID_ARG, "retrieve_wav_data_channels: null argument");
+        return ERR_INVALID_ARG;
+    }
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        set_error(ERR_IO, "retrieve_wav_data_channels: cannot open file");
+        return ERR_IO;
+    }
+
+    ErrorCode rc = parse_wav_header(fp, out_wh);
+    if (rc == ERR_OK)
+        rc = read_and_convert_data_channels(fp, out_wh, out_type, sel, out_samples, out_frames, out_channels);
+    fclose(fp);
+    return rc;
+}
+
+/**
+ * Loads frames [start_frame, start_frame + n_frames) of a WAV file converted to out_type, seeking straight
+ * to them from the data_offset of the header: only the requested range is read and decoded.
+ * The range is clamped to the end of the data chunk.
+ * @param filename Path of the WAV file
+ * @param out_type SAMPLE_S16 or SAMPLE_F32
+ * @param start_frame First frame to read (< number of frames of the file)
+ * @param n_frames Number of frames to read (> 0)
+ * @param out_wh Receives the parsed header (describing the whole file)
+ * @param out_samples Receives a malloc'ed buffer of out_frames * num_channels interleaved samples
+ * @param out_frames Receives the number of frames actually read
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode retrieve_wav_data_range(const char *filename, SampleType out_type, uint64_t start_frame, uint64_t n_frames,
+                                  struct wav_header *out_wh, void **out_samples, uint64_t *out_frames)
+{
+    if (!filename || !out_wh || n_frames == 0)
+    {
+        set_error(ERR_INVALID_ARG, "retrieve_wav_data_range: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        set_error(ERR_IO, "retrieve_wav_data_range: cannot open file");
+        return ERR_IO;
+    }
+
+    ErrorCode rc = parse_wav_header(fp, out_wh);
+    if (rc == ERR_OK && (out_wh->block_align == 0 || start_frame >= out_wh->subchunk2_size / out_wh->block_align))
+    {
+        set_error(ERR_INVALID_ARG, "retrieve_wav_data_range: start_frame beyond the data chunk");
+        rc = ERR_INVALID_ARG;
+    }
+    if (rc == ERR_OK)
+    {
+        // Sous-en-tête limité à la plage demandée, décodé par le chemin commun
+        struct wav_header range = *out_wh;
+        uint64_t available = out_wh->subchunk2_size / out_wh->block_align - start_frame;
+        range.subchunk2_size = (n_frames < available ? n_frames : available) * out_wh->block_align;
+        if (fseeko(fp, (off_t)(out_wh->data_offset + start_frame * out_wh->block_align), SEEK_SET) != 0)
+        {
+            set_error(ERR_IO, "retrieve_wav_data_range: seek failed");
+            rc = ERR_IO;
+        }
+        else
+            rc = read_and_convert_data(fp, &range, out_type, out_samples, out_frames);
+    }
+    fclose(fp);
+    return rc;
+}
+
+int retrieve_wav_data(char *filename, struct wav_header *out_wh, int16_t **out_samples, uint64_t *out_frames)
+{
+    // We initiate the file pointer
+    FILE *fp;
+    // We open the file
+    fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        set_error(ERR_IO, "retrieve_wav_data: cannot open file");
+        return ERR_IO;
+    }
+    // We read the header of the wav file we opened, which leaves fp on the first sample
+    ErrorCode rc = parse_wav_header(fp, out_wh);
+    if (rc != ERR_OK)
+    {
+        fclose(fp);
+        return rc;
+    }
+    // We initiate the pointers that allow us to store the wav file data
+
+    int error_code = read_and_convert_data_s16le(fp, out_wh, out_samples, out_frames);
+    fclose(fp);
+    return error_code;
+}
+
+/**
+ * Maps a WAV file in memory and exposes its data chunk as a read-only int16_t view.
+ * On little-endian hosts with 16-bit PCM whose data chunk sits on an even offset, no sample is copied:
+ * out_map->samples points straight into the mapping. Otherwise the samples are decoded into a private
+ * buffer through read_and_convert_data, so the caller always gets the same interleaved layout.
+ * The view must be released with release_wav_data_mmap.
+ * @param filename Path of the WAV file
+ * @param out_map Mapping descriptor filled on success
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode retrieve_wav_data_mmap(const char *filename, struct wav_mapping *out_map)
+{
+    if (!filename || !out_map)
+    {
+        set_error(ERR_INVALID_ARG, "retrieve_wav_data_mmap: null argument");
+        return ERR_INVALID_ARG;
+    }
+    memset(out_map, 0, sizeof(*out_map));
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        set_error(ERR_IO, "retrieve_wav_data_mmap: cannot open file");
+        return ERR_IO;
+    }
+
+    struct wav_header hdr;
+    ErrorCode rc = parse_wav_header(fp, &hdr);
+    if (rc != ERR_OK)
+    {
+        fclose(fp);
+        return rc;
+    }
+    off_t data_offset = (off_t)hdr.data_offset;
+
+    out_map->header = hdr;
+
+    int is_pcm16 = hdr.sample_format == WAVE_FORMAT_PCM && hdr.bits_per_sample == 16 &&
+                   hdr.num_channels > 0 && hdr.block_align == hdr.num_channels * 2 &&
+                   hdr.subchunk2_size > 0 && (hdr.subchunk2_size % hdr.block_align) == 0;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (is_pcm16 && (data_offset % (off_t)sizeof(int16_t)) == 0)
+    {
+        // mmap wants a page-aligned offset: we map from the page holding the start of the data chunk
+        off_t page_size = (off_t)sysconf(_SC_PAGESIZE);
+        off_t map_offset = data_offset - data_offset % page_size;
+        uint64_t map_length = (uint64_t)(data_offset - map_offset) + hdr.subchunk2_size;
+
+        void *base = map_length > SIZE_MAX ? MAP_FAILED : mmap(NULL, map_length, PROT_READ, MAP_PRIVATE, fileno(fp), map_offset);
+        if (base != MAP_FAILED)
+        {
+            // Feature extraction walks the samples front to back
+            madvise(base, map_length, MADV_SEQUENTIAL);
+            fclose(fp);
+
+            out_map->map_base = base;
+            out_map->map_length = (size_t)map_length;
+            out_map->frames = hdr.subchunk2_size / hdr.block_align;
+            out_map->samples = (const int16_t *)((const unsigned char *)base + (data_offset - map_offset));
+            return ERR_OK;
+        }
+    }
+#endif
+
+    // Fallback: other sample formats, big-endian host, odd data offset or mmap failure,
+    // we decode into an owned int16 buffer
+    void *copy = NULL;
+    uint64_t frames = 0;
+    rc = read_and_convert_data(fp, &hdr, SAMPLE_S16, &copy, &frames);
+    fclose(fp);
+    if (rc != ERR_OK)
+    {
+        memset(out_map, 0, sizeof(*out_map));
+        return rc;
+    }
+    out_map->samples = copy;
+    out_map->frames = frames;
+    return ERR_OK;
+}
+
+/**
+ * Releases a view obtained with retrieve_wav_data_mmap (unmaps the file or frees the decoded copy)
+ * @param map Mapping descriptor, reset to zero on return
+ */
+void release_wav_data_mmap(struct wav_mapping *map)
+{
+    if (!map)
+        return;
+
+    if (map->map_base)
+        munmap(map->map_base, map->map_length);
+    else
+        free((void *)map->samples);
+
+    memset(map, 0, sizeof(*map));
+}
+
+/**
+ * Prints the read header from the WAV file
+ * @param wh a struct representing the WAV header
+ */
+void print_wav_header(struct wav_header wh)
+{
+    printf("ChunkID\t\t\t%s\n", wh.chunk_id);
+    printf("ChunkSize\t\t%" PRIu64 "\n", wh.chunk_size);
+    printf("Format\t\t\t%s\n\n", wh.format);
+
+    printf("Subchunk1ID\t\t%s\n", wh.subchunk1_id);
+    printf("Subchunk1Size\t%" PRIu32 "\n", wh.subchunk1_size);
+    printf("AudioFormat\t\t%" PRIu16 "\n", wh.audio_format);
+    printf("NumChannels\t\t%" PRIu16 "\n", wh.num_channels);
+    printf("SampleRate\t\t%" PRIu32 "\n", wh.sample_rate);
+    printf("ByteRate\t\t%" PRIu32 "\n", wh.byte_rate);
+    printf("BlockAlign\t\t%" PRIu16 "\n", wh.block_align);
+    printf("BitsPerSample\t%" PRIu16 "\n\n", wh.bits_per_sample);
+
+    printf("Subchunk2ID\t\t%s\n", wh.subchunk2_id);
+    printf("Subchunk2Size\t%" PRIu64 "\n", wh.subchunk2_size);
+    printf("DataOffset\t\t%" PRIu64 "\n", wh.data_offset);
+}
+
+/**
+ * Prints the data from the buffer data specified
+ * This code only works for a PCM format equal to 1, and a bits per sample value equal to 16
+ * @param wh a struct representing the WAV header
+ * @param buffer Pointer to unsigned char* that will point to audio data
+ */
+void print_data(struct wav_header *wh, unsigned char *buffer, int frames_to_print)
+{
+    const int channels = wh->num_channels;
+    const int bytes_per_sample = wh->bits_per_sample / 8; // supposé 2 ici
+    const int bytes_per_frame = wh->block_align;          // = channels * bytes_per_sample
+
+    if (wh->audio_format != 1 || wh->bits_per_sample != 16)
+    {
+        fprintf(stderr, "Cette fonction suppose PCM 16-bit.\n");
+        return;
+    }
+
+    uint64_t max_frames = wh->subchunk2_size / (uint64_t)bytes_per_frame;
+    if ((uint64_t)frames_to_print > max_frames)
+        frames_to_print = (int)max_frames;
+
+    for (int f = 0; f < frames_to_print; ++f)
+    {
+        size_t base = (size_t)f * (size_t)bytes_per_frame;
+        printf("%d.", f);
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            size_t off = base + (size_t)ch * (size_t)bytes_per_sample;
+
+            // Little-endian: low, high
+            uint16_t u = (uint16_t)buffer[off] | ((uint16_t)buffer[off + 1] << 8);
+            int16_t s = (int16_t)u; // interprétation signée (audio classique)
+
+            // Affiche signé (valeur audio) et non signé si tu veux comparer
+            printf(" ch%d:%d(u=%u hex=0x%04X)", ch, (int)s, (unsigned)u, (unsigned)u);
+        }
+        printf("\n");
+    }
+}
+
+// Fills out[f - f0] with the peak of frames [f0, f1) using a monotonic deque of sample indices:
+// every sample enters and leaves the deque once, so the cost does not depend on frame_length
+static ErrorCode envelope_frames(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, size_t pad,
+                                 size_t f0, size_t f1, float *out)
+{
+    // Ring buffer of indices whose magnitudes decrease from head to tail, never more than one frame long
+    size_t *deque = malloc(frame_length * sizeof *deque);
+    if (!deque)
+        return ERR_OUT_OF_MEMORY;
+
+    size_t head = 0, count = 0;
+    size_t next = 0; // next sample index to enter the deque
+
+    for (size_t f = f0; f < f1; ++f)
+    {
+        size_t start = f * hop_length;
+        size_t end = start + frame_length;
+        size_t lo = start > pad ? start - pad : 0;
+        size_t hi = end > pad ? end - pad : 0;
+        if (hi > N)
+            hi = N;
+
+        // On retire les indices sortis de la frame
+        while (count > 0 && deque[head] < lo)
+        {
+            head = (head + 1) % frame_length;
+            --count;
+        }
+        if (next < lo)
+            next = lo;
+
+        for (; next < hi; ++next)
+        {
+            int mag = abs((int)samples[next]);
+            // Un échantillon plus grand rend inutiles ceux qui le précèdent
+            while (count > 0 && abs((int)samples[deque[(head + count - 1) % frame_length]]) <= mag)
+                --count;
+            deque[(head + count) % frame_length] = next;
+            ++count;
+        }
+
+        // Le padding vaut 0 : une frame sans échantillon réel a une enveloppe nulle
+        int peak = count > 0 ? abs((int)samples[deque[head]]) : 0;
+        out[f - f0] = (float)peak / 32768.0f;
+    }
+
+    free(deque);
+    return ERR_OK;
+}
+
+/**
+ * Computes the framewise amplitude envelope (peak of |x| in each frame), with the frame/hop/center
+ * semantics of zero_crossing_rate. Values are relative to full scale (divided by 32768).
+ * The sliding maximum runs in O(N) whatever frame_length is.
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param frame_length Number of samples per frame (>= 1)
+ * @param hop_length Number of samples between two frame starts (> 0)
+ * @param center Non-zero to pad frame_length / 2 zeros on both sides
+ * @param envelope_out Receives a malloc'ed array of n_frames_out values (NULL when there is no frame)
+ * @param n_frames_out Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode amplitude_envelope(
+    const int16_t *samples,
+    size_t N,
+    size_t frame_length,
+    size_t hop_length,
+    int center,
+    float **envelope_out,
+    size_t *n_frames_out)
+{
+    if ((!samples && N > 0) || !envelope_out || !n_frames_out || frame_length == 0 || hop_length == 0)
+    {
+        set_error(ERR_INVALID_ARG, "amplitude_envelope: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    size_t pad = center ? frame_length / 2 : 0;
+    size_t n_frames = frame_count(N, frame_length, hop_length, center);
+
+    *n_frames_out = n_frames;
+    if (n_frames == 0)
+    {
+        *envelope_out = NULL;
+        return ERR_OK;
+    }
+
+    float *buf = malloc(n_frames * sizeof *buf);
+    if (!buf || envelope_frames(samples, N, frame_length, hop_length, pad, 0, n_frames, buf) != ERR_OK)
+    {
+        free(buf);
+        set_error(ERR_OUT_OF_MEMORY, "amplitude_envelope: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    *envelope_out = buf;
+    return ERR_OK;
+}
+
+// Fills out[f - f0] with the RMS of frames [f0, f1), sliding the sum of squares from frame to frame
+static void rms_frames(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, size_t pad,
+                       size_t f0, size_t f1, float *out)
+{
+    uint64_t (*sumsq)(const int16_t *, size_t) = kernels()->sumsq_i16;
+    size_t lo = 0, hi = 0;
+    uint64_t acc = 0;
+
+    for (size_t f = f0; f < f1; ++f)
+    {
+        size_t start = f * hop_length;
+        size_t end = start + frame_length;
+        size_t new_lo = start > pad ? start - pad : 0;
+        size_t new_hi = end > pad ? end - pad : 0;
+        if (new_hi > N)
+            new_hi = N;
+        if (new_lo > new_hi)
+            new_lo = new_hi;
+
+        // Les bornes ne font qu'avancer : on retire ce qui sort et on ajoute ce qui entre,
+        // sauf si recalculer la frame coûte moins cher (hop_length proche de frame_length)
+        if (f > f0 && new_lo <= hi && (new_lo - lo) + (new_hi - hi) < new_hi - new_lo)
+            acc = acc - sumsq(samples + lo, new_lo - lo) + sumsq(samples + hi, new_hi - hi);
+        else
+            acc = sumsq(samples + new_lo, new_hi - new_lo);
+
+        lo = new_lo;
+        hi = new_hi;
+        // Les échantillons de padding valent 0 mais comptent dans la moyenne, comme librosa
+        out[f - f0] = (float)(sqrt((double)acc / (double)frame_length) / 32768.0);
+    }
+}
+
+/**
+ * Computes the framewise RMS energy of a signal, with the frame/hop/center semantics of zero_crossing_rate.
+ * Values are relative to full scale (int16 samples divided by 32768), like librosa.feature.rms on a
+ * float signal loaded by librosa. Sums of squares are exact 64-bit integers slid from one frame to the next.
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param frame_length Number of samples per frame (>= 1)
+ * @param hop_length Number of samples between two frame starts (> 0)
+ * @param center Non-zero to pad frame_length / 2 zeros on both sides
+ * @param rms_out Receives a malloc'ed array of n_frames_out values (NULL when there is no frame)
+ * @param n_frames_out Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode rms(
+    const int16_t *samples,
+    size_t N,
+    size_t frame_length,
+    size_t hop_length,
+    int center,
+    float **rms_out,
+    size_t *n_frames_out)
+{
+    if ((!samples && N > 0) || !rms_out || !n_frames_out || frame_length == 0 || hop_length == 0)
+    {
+        set_error(ERR_INVALID_ARG, "rms: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    size_t pad = center ? frame_length / 2 : 0;
+    size_t n_frames = frame_count(N, frame_length, hop_length, center);
+
+    *n_frames_out = n_frames;
+    if (n_frames == 0)
+    {
+        *rms_out = NULL;
+        return ERR_OK;
+    }
+
+    float *buf = malloc(n_frames * sizeof *buf);
+    if (!buf)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "rms: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    rms_frames(samples, N, frame_length, hop_length, pad, 0, n_frames, buf);
+    *rms_out = buf;
+    return ERR_OK;
+}
+
+// Fills out[f - f0] with the ZCR of frames [f0, f1)
+static void zcr_frames(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, size_t pad,
+                       size_t f0, size_t f1, float *out)
+{
+    for (size_t f = f0; f < f1; ++f)
+    {
+        // La frame couvre les indices paddés [start, end), les indices réels sont décalés de pad
+        size_t start = f * hop_length;
+        size_t end = start + frame_length;
+        size_t lo = start > pad ? start - pad : 0;
+        size_t hi = end > pad ? end - pad : 0;
+        if (hi > N)
+            hi = N;
+
+        // Dans la zone paddée, les échantillons “hors signal” valent 0 : seules les paires
+        // (0, x[0]) et (x[N-1], 0) à la frontière peuvent compter un passage
+        size_t acc = 0;
+        if (lo < hi)
+        {
+            acc = zcr_count(samples + lo, hi - lo);
+            if (start < pad)
+                acc += (size_t)abs(sgn_i16(samples[0]));
+            if (end > pad + N)
+                acc += (size_t)abs(sgn_i16(samples[N - 1]));
+        }
+        out[f - f0] = zcr_from_count(acc, frame_length);
+    }
+}
+
+ErrorCode zero_crossing_rate(
+    const int16_t *samples,
+    size_t N,
+    size_t frame_length,
+    size_t hop_length,
+    int center,
+    float **zcr_out, 
+    size_t *n_frames_out)
+{
+    if (!samples || !zcr_out || !n_frames_out || frame_length < 2 || hop_length == 0)
+        return ERR_INVALID_ARG;
+
+    size_t pad = center ? frame_length / 2 : 0;
+    size_t n_frames = frame_count(N, frame_length, hop_length, center);
+
+    *n_frames_out = n_frames;
+
+    if (n_frames == 0)
+    {
+        *zcr_out = NULL;
+        return ERR_OK;
+    }
+
+    float *buf = malloc(n_frames * sizeof *buf);
+    if (!buf)
+        return ERR_OUT_OF_MEMORY; // selon tes codes d’erreur
+
+    zcr_frames(samples, N, frame_length, hop_length, pad, 0, n_frames, buf);
+    *zcr_out = buf;
+    return ERR_OK;
+}
+
+// Crossing indicator prefix sums shared by every (frame_length, hop_length, center) configuration
+struct zcr_prefix {
+    uint32_t *cum;     // cum[i] = crossings over the pairs (0,1) .. (i-1,i), modulo 2^32
+    size_t N;
+    unsigned first;    // |sign(x[0])|, crossing against the left padding
+    unsigned last;     // |sign(x[N-1])|, crossing against the right padding
+};
+
+/**
+ * Computes the per-sample crossing indicator once and stores its prefix sums, so that the ZCR of any
+ * frame becomes a difference of two entries. The sums wrap modulo 2^32, which keeps frame differences
+ * exact (a frame never holds 2^32 crossings) while costing 4 bytes per sample.
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param out_prefix Receives the prefix table, to release with zcr_prefix_free
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode zcr_prefix_build(const int16_t *samples, size_t N, struct zcr_prefix **out_prefix)
+{
+    if ((!samples && N > 0) || !out_prefix)
+    {
+        set_error(ERR_INVALID_ARG, "zcr_prefix_build: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    struct zcr_prefix *prefix = calloc(1, sizeof *prefix);
+    uint32_t *cum = malloc((N ? N : 1) * sizeof *cum);
+    if (!prefix || !cum)
+    {
+        free(prefix);
+        free(cum);
+        set_error(ERR_OUT_OF_MEMORY, "zcr_prefix_build: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    prefix->cum = cum;
+    prefix->N = N;
+    *out_prefix = prefix;
+    if (N == 0)
+        return ERR_OK;
+
+    uint32_t acc = 0;
+    int prev = sgn_i16(samples[0]);
+    cum[0] = 0;
+    for (size_t i = 1; i < N; ++i)
+    {
+        int cur = sgn_i16(samples[i]);
+        acc += (uint32_t)abs(cur - prev);
+        cum[i] = acc;
+        prev = cur;
+    }
+
+    prefix->first = (unsigned)abs(sgn_i16(samples[0]));
+    prefix->last = (unsigned)abs(prev);
+    return ERR_OK;
+}
+
+/**
+ * Same output as zero_crossing_rate, derived in O(1) per frame from a prefix table
+ * @param prefix Table built by zcr_prefix_build
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode zero_crossing_rate_prefix(
+    const struct zcr_prefix *prefix,
+    size_t frame_length,
+    size_t hop_length,
+    int center,
+    float **zcr_out,
+    size_t *n_frames_out)
+{
+    if (!prefix || !zcr_out || !n_frames_out || frame_length < 2 || hop_length == 0)
+    {
+        set_error(ERR_INVALID_ARG, "zero_crossing_rate_prefix: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    const size_t N = prefix->N;
+    size_t pad = center ? frame_length / 2 : 0;
+    size_t n_frames = frame_count(N, frame_length, hop_length, center);
+
+    *n_frames_out = n_frames;
+    if (n_frames == 0)
+    {
+        *zcr_out = NULL;
+        return ERR_OK;
+    }
+
+    float *buf = malloc(n_frames * sizeof *buf);
+    if (!buf)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "zero_crossing_rate_prefix: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    for (size_t f = 0; f < n_frames; ++f)
+    {
+        size_t start = f * hop_length;
+        size_t end = start + frame_length;
+        size_t lo = start > pad ? start - pad : 0;
+        size_t hi = end > pad ? end - pad : 0;
+        if (hi > N)
+            hi = N;
+
+        size_t acc = 0;
+        if (lo < hi)
+        {
+            // Paires (lo, lo+1) .. (hi-2, hi-1) : la soustraction modulo 2^32 reste exacte
+            acc = (size_t)(uint32_t)(prefix->cum[hi - 1] - prefix->cum[lo]);
+            if (start < pad)
+                acc += prefix->first;
+            if (end > pad + N)
+                acc += prefix->last;
+        }
+        buf[f] = zcr_from_count(acc, frame_length);
+    }
+
+    *zcr_out = buf;
+    return ERR_OK;
+}
+
+void zcr_prefix_free(struct zcr_prefix *prefix)
+{
+    if (!prefix)
+        return;
+    free(prefix->cum);
+    free(prefix);
+}
+
+// ########################################## FLOAT FEATURES ##########################################
+
+// Same features computed on float32 samples in [-1, 1) (see retrieve_wav_data_as with SAMPLE_F32),
+// so that 24-bit, 32-bit and float files are analysed without being truncated to 16 bits.
+
+static inline int sgn_f32(float x)
+{
+    return (x > 0.0f) - (x < 0.0f);
+}
+
+// Fills out[f - f0] with the ZCR of frames [f0, f1), same boundary rules as zcr_frames
+static void zcr_frames_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, size_t pad,
+                           size_t f0, size_t f1, float *out)
+{
+    for (size_t f = f0; f < f1; ++f)
+    {
+        size_t start = f * hop_length;
+        size_t end = start + frame_length;
+        size_t lo = start > pad ? start - pad : 0;
+        size_t hi = end > pad ? end - pad : 0;
+        if (hi > N)
+            hi = N;
+
+        size_t acc = 0;
+        if (lo < hi)
+        {
+            for (size_t i = lo + 1; i < hi; ++i)
+                acc += (size_t)abs(sgn_f32(samples[i]) - sgn_f32(samples[i - 1]));
+            if (start < pad)
+                acc += (size_t)abs(sgn_f32(samples[0]));
+            if (end > pad + N)
+                acc += (size_t)abs(sgn_f32(samples[N - 1]));
+        }
+        out[f - f0] = zcr_from_count(acc, frame_length);
+    }
+}
+
+// Fills out[f - f0] with the RMS of frames [f0, f1). A floating-point running sum would drift over long
+// files, so each frame is summed again in double precision.
+static void rms_frames_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, size_t pad,
+                           size_t f0, size_t f1, float *out)
+{
+    for (size_t f = f0; f < f1; ++f)
+    {
+        size_t start = f * hop_length;
+        size_t end = start + frame_length;
+        size_t lo = start > pad ? start - pad : 0;
+        size_t hi = end > pad ? end - pad : 0;
+        if (hi > N)
+            hi = N;
+
+        double acc = 0.0;
+        for (size_t i = lo; i < hi; ++i)
+            acc += (double)samples[i] * (double)samples[i];
+        out[f - f0] = (float)sqrt(acc / (double)frame_length);
+    }
+}
+
+// Fills out[f - f0] with the peak of |x| over frames [f0, f1), monotonic deque as in envelope_frames
+static ErrorCode envelope_frames_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length,
+                                     size_t pad, size_t f0, size_t f1, float *out)
+{
+    size_t *deque = malloc(frame_length * sizeof *deque);
+    if (!deque)
+        return ERR_OUT_OF_MEMORY;
+
+    size_t head = 0, count = 0;
+    size_t next = 0;
+
+    for (size_t f = f0; f < f1; ++f)
+    {
+        size_t start = f * hop_length;
+        size_t end = start + frame_length;
+        size_t lo = start > pad ? start - pad : 0;
+        size_t hi = end > pad ? end - pad : 0;
+        if (hi > N)
+            hi = N;
+
+        while (count > 0 && deque[head] < lo)
+        {
+            head = (head + 1) % frame_length;
+            --count;
+        }
+        if (next < lo)
+            next = lo;
+
+        for (; next < hi; ++next)
+        {
+            float mag = fabsf(samples[next]);
+            while (count > 0 && fabsf(samples[deque[(head + count - 1) % frame_length]]) <= mag)
+                --count;
+            deque[(head + count) % frame_length] = next;
+            ++count;
+        }
+
+        out[f - f0] = count > 0 ? fabsf(samples[deque[head]]) : 0.0f;
+    }
+
+    free(deque);
+    return ERR_OK;
+}
+
+// Validation, allocation and framing shared by the three float entry points
+static ErrorCode float_feature(FeatureFlags feature, const char *name, const float *samples, size_t N,
+                               size_t frame_length, size_t hop_length, int center, float **out, size_t *n_frames_out)
+{
+    size_t min_length = feature == FEATURE_ZCR ? 2 : 1;
+    if ((!samples && N > 0) || !out || !n_frames_out || frame_length < min_length || hop_length == 0)
+    {
+        set_error(ERR_INVALID_ARG, name);
+        return ERR_INVALID_ARG;
+    }
+
+    size_t pad = center ? frame_length / 2 : 0;
+    size_t n_frames = frame_count(N, frame_length, hop_length, center);
+
+    *n_frames_out = n_frames;
+    if (n_frames == 0)
+    {
+        *out = NULL;
+        return ERR_OK;
+    }
+
+    float *buf = malloc(n_frames * sizeof *buf);
+    ErrorCode rc = buf ? ERR_OK : ERR_OUT_OF_MEMORY;
+    if (rc == ERR_OK && feature == FEATURE_ZCR)
+        zcr_frames_f32(samples, N, frame_length, hop_length, pad, 0, n_frames, buf);
+    else if (rc == ERR_OK && feature == FEATURE_RMS)
+        rms_frames_f32(samples, N, frame_length, hop_length, pad, 0, n_frames, buf);
+    else if (rc == ERR_OK)
+        rc = envelope_frames_f32(samples, N, frame_length, hop_length, pad, 0, n_frames, buf);
+
+    if (rc != ERR_OK)
+    {
+        free(buf);
+        set_error(ERR_OUT_OF_MEMORY, "float feature: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    *out = buf;
+    return ERR_OK;
+}
+
+/**
+ * Float32 variant of zero_crossing_rate, same framing and output
+ * @param samples Mono float samples
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode zero_crossing_rate_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, int center,
+                                 float **zcr_out, size_t *n_frames_out)
+{
+    return float_feature(FEATURE_ZCR, "zero_crossing_rate_f32: invalid argument", samples, N, frame_length,
+                         hop_length, center, zcr_out, n_frames_out);
+}
+
+/**
+ * Float32 variant of rms. Samples are already relative to full scale, so values match rms on the
+ * int16 version of the same signal.
+ * @param samples Mono float samples
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode rms_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, int center,
+                  float **rms_out, size_t *n_frames_out)
+{
+    return float_feature(FEATURE_RMS, "rms_f32: invalid argument", samples, N, frame_length, hop_length, center,
+                         rms_out, n_frames_out);
+}
+
+/**
+ * Float32 variant of amplitude_envelope
+ * @param samples Mono float samples
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode amplitude_envelope_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, int center,
+                                 float **envelope_out, size_t *n_frames_out)
+{
+    return float_feature(FEATURE_ENVELOPE, "amplitude_envelope_f32: invalid argument", samples, N, frame_length,
+                         hop_length, center, envelope_out, n_frames_out);
+}
+
+// ########################################## MULTI-FEATURE ##########################################
+
+/**
+ * Number of frames produced by the feature functions for a signal of N samples
+ */
+size_t feature_frame_count(size_t N, size_t frame_length, size_t hop_length, int center)
+{
+    if (frame_length == 0 || hop_length == 0)
+        return 0;
+    return frame_count(N, frame_length, hop_length, center);
+}
+
+// Allocates the requested arrays of out that are still NULL; on failure only those are released
+static ErrorCode feature_set_alloc(struct feature_set *out, unsigned features, size_t n_frames)
+{
+    float **slots[3] = {&out->zcr, &out->rms, &out->envelope};
+    const unsigned flags[3] = {FEATURE_ZCR, FEATURE_RMS, FEATURE_ENVELOPE};
+    unsigned allocated = 0;
+
+    for (int k = 0; k < 3; ++k)
+    {
+        if (!(features & flags[k]) || *slots[k])
+            continue;
+        *slots[k] = malloc(n_frames * sizeof(float));
+        if (!*slots[k])
+        {
+            for (int j = 0; j < k; ++j)
+                if (allocated & flags[j])
+                {
+                    free(*slots[j]);
+                    *slots[j] = NULL;
+                }
+            return ERR_OUT_OF_MEMORY;
+        }
+        allocated |= flags[k];
+    }
+    return ERR_OK;
+}
+
+// Computes the requested features of frames [f0, f1) into out->zcr/rms/envelope[f], one pass per frame
+static void fused_frames(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, size_t pad,
+                         unsigned features, size_t f0, size_t f1, const struct feature_set *out)
+{
+    void (*frame_stats)(const int16_t *, size_t, struct frame_stats *) = kernels()->frame_stats_i16;
+
+    for (size_t f = f0; f < f1; ++f)
+    {
+        size_t start = f * hop_length;
+        size_t end = start + frame_length;
+        size_t lo = start > pad ? start - pad : 0;
+        size_t hi = end > pad ? end - pad : 0;
+        if (hi > N)
+            hi = N;
+
+        struct frame_stats st = {0, 0, 0};
+        if (lo < hi)
+        {
+            frame_stats(samples + lo, hi - lo, &st);
+            // Paires contre le padding, comme dans zero_crossing_rate
+            if (start < pad)
+                st.crossings += (uint64_t)abs(sgn_i16(samples[0]));
+            if (end > pad + N)
+                st.crossings += (uint64_t)abs(sgn_i16(samples[N - 1]));
+        }
+
+        if (features & FEATURE_ZCR)
+            out->zcr[f] = zcr_from_count((size_t)st.crossings, frame_length);
+        if (features & FEATURE_RMS)
+            out->rms[f] = (float)(sqrt((double)st.sumsq / (double)frame_length) / 32768.0);
+        if (features & FEATURE_ENVELOPE)
+            out->envelope[f] = (float)st.peak / 32768.0f;
+    }
+}
+
+/**
+ * Computes several framewise features in a single pass over each frame, so the signal is streamed from
+ * memory once instead of once per feature. Results are identical to zero_crossing_rate, rms and
+ * amplitude_envelope called separately.
+ * Each requested array left NULL in out is malloc'ed; a non-NULL one is used as is and must hold
+ * feature_frame_count(N, frame_length, hop_length, center) values. Arrays of features that are not
+ * requested are left untouched.
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param frame_length Number of samples per frame (>= 2)
+ * @param hop_length Number of samples between two frame starts (> 0)
+ * @param center Non-zero to pad frame_length / 2 zeros on both sides
+ * @param features Bitmask of FeatureFlags
+ * @param out Output arrays, out->n_frames receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode extract_features(
+    const int16_t *samples,
+    size_t N,
+    size_t frame_length,
+    size_t hop_length,
+    int center,
+    unsigned features,
+    struct feature_set *out)
+{
+    if ((!samples && N > 0) || !out || frame_length < 2 || hop_length == 0 ||
+        features == 0 || (features & ~(unsigned)FEATURE_ALL) != 0)
+    {
+        set_error(ERR_INVALID_ARG, "extract_features: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    size_t pad = center ? frame_length / 2 : 0;
+    size_t n_frames = frame_count(N, frame_length, hop_length, center);
+    out->n_frames = n_frames;
+    if (n_frames == 0)
+        return ERR_OK;
+
+    if (feature_set_alloc(out, features, n_frames) != ERR_OK)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "extract_features: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    fused_frames(samples, N, frame_length, hop_length, pad, features, 0, n_frames, out);
+    return ERR_OK;
+}
+
+// ########################################## OUTPUT BUFFERS ##########################################
+
+// Validation and framing shared by the *_into variants; on a too small buffer, n_frames_out still
+// receives the required number of frames
+static ErrorCode into_prepare(const char *name, const int16_t *samples, size_t N, size_t frame_length,
+                              size_t min_frame_length, size_t hop_length, int center, const float *out,
+                              size_t capacity, size_t *n_frames_out)
+{
+    if ((!samples && N > 0) || !n_frames_out || frame_length < min_frame_length || hop_length == 0)
+    {
+        set_error(ERR_INVALID_ARG, name);
+        return ERR_INVALID_ARG;
+    }
+
+    size_t n_frames = frame_count(N, frame_length, hop_length, center);
+    *n_frames_out = n_frames;
+    if (n_frames > capacity || (n_frames > 0 && !out))
+    {
+        set_error(ERR_INVALID_ARG, "*_into: output buffer smaller than feature_frame_count");
+        return ERR_INVALID_ARG;
+    }
+    return ERR_OK;
+}
+
+/**
+ * Same as zero_crossing_rate, written into a caller buffer instead of a malloc'ed one
+ * @param zcr_out Buffer of at least feature_frame_count(N, frame_length, hop_length, center) values
+ * @param capacity Number of values zcr_out can hold
+ * @param n_frames_out Receives the number of frames (also when capacity is too small)
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode zero_crossing_rate_into(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length,
+                                  int center, float *zcr_out, size_t capacity, size_t *n_frames_out)
+{
+    ErrorCode rc = into_prepare("zero_crossing_rate_into: invalid argument", samples, N, frame_length, 2, hop_length,
+                                center, zcr_out, capacity, n_frames_out);
+    if (rc == ERR_OK)
+        zcr_frames(samples, N, frame_length, hop_length, center ? frame_length / 2 : 0, 0, *n_frames_out, zcr_out);
+    return rc;
+}
+
+/**
+ * Same as rms, written into a caller buffer instead of a malloc'ed one (see zero_crossing_rate_into)
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode rms_into(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, int center,
+                   float *rms_out, size_t capacity, size_t *n_frames_out)
+{
+    ErrorCode rc = into_prepare("rms_into: invalid argument", samples, N, frame_length, 1, hop_length, center,
+                                rms_out, capacity, n_frames_out);
+    if (rc == ERR_OK)
+        rms_frames(samples, N, frame_length, hop_length, center ? frame_length / 2 : 0, 0, *n_frames_out, rms_out);
+    return rc;
+}
+
+/**
+ * Same as amplitude_envelope, written into a caller buffer instead of a malloc'ed one
+ * (see zero_crossing_rate_into). The sliding maximum still needs frame_length indices of scratch.
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode amplitude_envelope_into(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length,
+                                  int center, float *envelope_out, size_t capacity, size_t *n_frames_out)
+{
+    ErrorCode rc = into_prepare("amplitude_envelope_into: invalid argument", samples, N, frame_length, 1, hop_length,
+                                center, envelope_out, capacity, n_frames_out);
+    if (rc == ERR_OK && *n_frames_out > 0 &&
+        envelope_frames(samples, N, frame_length, hop_length, center ? frame_length / 2 : 0, 0, *n_frames_out,
+                        envelope_out) != ERR_OK)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "amplitude_envelope_into: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    return rc;
+}
+
+// Arena blocks are chained newest first; allocations are aligned for the vector kernels
+#define ARENA_ALIGN 64
+#define ARENA_DEFAULT_BLOCK ((size_t)1 << 20)
+
+struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+    unsigned char data[];
+};
+
+struct feature_arena {
+    struct arena_block *head;
+    size_t block_size;
+};
+
+static struct arena_block *arena_block_new(size_t size, struct arena_block *next)
+{
+    struct arena_block *block = malloc(sizeof *block + size);
+    if (!block)
+        return NULL;
+    block->next = next;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+/**
+ * Creates a bump allocator for the outputs of one file: allocations are a pointer increment and
+ * everything is released at once by feature_arena_reset or feature_arena_free.
+ * @param block_size Size of the first block in bytes (0 = 1 MiB); the arena grows by blocks when needed
+ * @param out_arena Receives the arena
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode feature_arena_create(size_t block_size, struct feature_arena **out_arena)
+{
+    if (!out_arena)
+    {
+        set_error(ERR_INVALID_ARG, "feature_arena_create: null argument");
+        return ERR_INVALID_ARG;
+    }
+    *out_arena = NULL;
+
+    struct feature_arena *arena = malloc(sizeof *arena);
+    if (!arena)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "feature_arena_create: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+    arena->head = arena_block_new(arena->block_size, NULL);
+    if (!arena->head)
+    {
+        free(arena);
+        set_error(ERR_OUT_OF_MEMORY, "feature_arena_create: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    *out_arena = arena;
+    return ERR_OK;
+}
+
+/**
+ * Allocates bytes from the arena, aligned on 64 bytes. The memory stays valid until the next
+ * feature_arena_reset or feature_arena_free and must not be passed to free.
+ * @return The allocation, or NULL when out of memory
+ */
+void *feature_arena_alloc(struct feature_arena *arena, size_t bytes)
+{
+    if (!arena || bytes > SIZE_MAX - ARENA_ALIGN)
+        return NULL;
+
+    struct arena_block *block = arena->head;
+    uintptr_t at = block ? (uintptr_t)(block->data + block->used) : 0;
+    size_t pad = (size_t)(-at & (ARENA_ALIGN - 1));
+    if (!block || block->size - block->used < pad || block->size - block->used - pad < bytes)
+    {
+        // Nouveau bloc assez grand pour la demande, padding d'alignement compris
+        size_t size = bytes + ARENA_ALIGN > arena->block_size ? bytes + ARENA_ALIGN : arena->block_size;
+        block = arena_block_new(size, arena->head);
+        if (!block)
+            return NULL;
+        arena->head = block;
+        at = (uintptr_t)block->data;
+        pad = (size_t)(-at & (ARENA_ALIGN - 1));
+    }
+
+    void *ptr = block->data + block->used + pad;
+    block->used += pad + bytes;
+    return ptr;
+}
+
+/**
+ * Points the requested arrays of out that are still NULL to arena memory of n_frames values each,
+ * ready for extract_features or the *_into variants
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode feature_arena_alloc_set(struct feature_arena *arena, unsigned features, size_t n_frames,
+                                  struct feature_set *out)
+{
+    if (!arena || !out || n_frames > SIZE_MAX / sizeof(float))
+    {
+        set_error(ERR_INVALID_ARG, "feature_arena_alloc_set: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    float **slots[3] = {&out->zcr, &out->rms, &out->envelope};
+    const unsigned flags[3] = {FEATURE_ZCR, FEATURE_RMS, FEATURE_ENVELOPE};
+    for (int k = 0; k < 3; ++k)
+    {
+        if (!(features & flags[k]) || *slots[k])
+            continue;
+        // Ce qui a déjà été pris reste dans l'arène jusqu'au prochain reset
+        *slots[k] = feature_arena_alloc(arena, (n_frames ? n_frames : 1) * sizeof(float));
+        if (!*slots[k])
+        {
+            set_error(ERR_OUT_OF_MEMORY, "feature_arena_alloc_set: allocation failed");
+            return ERR_OUT_OF_MEMORY;
+        }
+    }
+    out->n_frames = n_frames;
+    return ERR_OK;
+}
+
+/**
+ * Releases every allocation of the arena at once. When the arena had to grow, its blocks are merged into
+ * a single one of the total size, so the next file of the same size is served without any malloc.
+ */
+void feature_arena_reset(struct feature_arena *arena)
+{
+    if (!arena)
+        return;
+
+    struct arena_block *block = arena->head;
+    if (!block || !block->next)
+    {
+        if (block)
+            block->used = 0;
+        return;
+    }
+
+    size_t total = 0;
+    while (block)
+    {
+        struct arena_block *next = block->next;
+        total += block->size;
+        free(block);
+        block = next;
+    }
+    // Si la fusion échoue, feature_arena_alloc recréera un bloc à la demande
+    arena->head = arena_block_new(total, NULL);
+    if (arena->head)
+        arena->block_size = total;
+}
+
+void feature_arena_free(struct feature_arena *arena)
+{
+    if (!arena)
+        return;
+    struct arena_block *block = arena->head;
+    while (block)
+    {
+        struct arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+// ########################################## MULTITHREADING ##########################################
+
+// Persistent workers executing one parallel-for at a time; the submitting thread takes part in it
+struct thread_pool {
+    pthread_t *threads;
+    size_t n_workers;            // background threads, the caller is the (n_workers + 1)-th
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;      // signaled when a job is published or on shutdown
+    pthread_cond_t done_cv;      // signaled when the last busy worker leaves a job
+    pthread_mutex_t submit_lock; // serializes thread_pool_run callers
+
+    // Current job, protected by lock
+    void (*task)(void *ctx, size_t index);
+    void *ctx;
+    size_t n_tasks;
+    size_t next_task;
+    size_t busy;
+    unsigned long generation;
+    int shutdown;
+};
+
+// Takes tasks of the current job until none is left (called and returns with pool->lock held)
+static void thread_pool_drain(struct thread_pool *pool)
+{
+    while (pool->next_task < pool->n_tasks)
+    {
+        size_t index = pool->next_task++;
+        void (*task)(void *, size_t) = pool->task;
+        void *ctx = pool->ctx;
+
+        pthread_mutex_unlock(&pool->lock);
+        task(ctx, index);
+        pthread_mutex_lock(&pool->lock);
+    }
+}
+
+static void *thread_pool_worker(void *arg)
+{
+    struct thread_pool *pool = arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->shutdown && pool->generation == seen)
+            pthread_cond_wait(&pool->work_cv, &pool->lock);
+        if (pool->shutdown)
+            break;
+
+        seen = pool->generation;
+        pool->busy++;
+        thread_pool_drain(pool);
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->done_cv);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * Creates a pool of persistent worker threads used by the *_mt feature variants
+ * @param n_threads Total number of threads taking part in a job, caller included (0 = online CPUs)
+ * @param out_pool Receives the pool, to release with thread_pool_free
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode thread_pool_create(size_t n_threads, struct thread_pool **out_pool)
+{
+    if (!out_pool)
+    {
+        set_error(ERR_INVALID_ARG, "thread_pool_create: null argument");
+        return ERR_INVALID_ARG;
+    }
+    if (n_threads == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = online > 0 ? (size_t)online : 1;
+    }
+
+    struct thread_pool *pool = calloc(1, sizeof *pool);
+    if (!pool || (n_threads > 1 && !(pool->threads = calloc(n_threads - 1, sizeof *pool->threads))))
+    {
+        free(pool);
+        set_error(ERR_OUT_OF_MEMORY, "thread_pool_create: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->submit_lock, NULL);
+    pthread_cond_init(&pool->work_cv, NULL);
+    pthread_cond_init(&pool->done_cv, NULL);
+
+    for (size_t t = 0; t + 1 < n_threads; ++t)
+    {
+        if (pthread_create(&pool->threads[t], NULL, thread_pool_worker, pool) != 0)
+        {
+            thread_pool_free(pool);
+            set_error(ERR_INTERNAL, "thread_pool_create: cannot start worker thread");
+            return ERR_INTERNAL;
+        }
+        pool->n_workers++;
+    }
+
+    *out_pool = pool;
+    return ERR_OK;
+}
+
+void thread_pool_free(struct thread_pool *pool)
+{
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = TRUE;
+    pthread_cond_broadcast(&pool->work_cv);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t t = 0; t < pool->n_workers; ++t)
+        pthread_join(pool->threads[t], NULL);
+
+    pthread_cond_destroy(&pool->work_cv);
+    pthread_cond_destroy(&pool->done_cv);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->submit_lock);
+    free(pool->threads);
+    free(pool);
+}
+
+size_t thread_pool_size(const struct thread_pool *pool)
+{
+    return pool ? pool->n_workers + 1 : 1;
+}
+
+// Runs task(ctx, 0) .. task(ctx, n_tasks - 1) on the pool and the calling thread, returns once all are done
+static void thread_pool_run(struct thread_pool *pool, size_t n_tasks, void (*task)(void *ctx, size_t index), void *ctx)
+{
+    pthread_mutex_lock(&pool->submit_lock);
+    pthread_mutex_lock(&pool->lock);
+
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->n_tasks = n_tasks;
+    pool->next_task = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_cv);
+
+    thread_pool_drain(pool);
+    while (pool->busy > 0)
+        pthread_cond_wait(&pool->done_cv, &pool->lock);
+
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->submit_lock);
+}
+
+// Below this many frames per thread, waking the workers costs more than it saves
+#define PARALLEL_MIN_FRAMES_PER_THREAD 64
+
+enum frames_job_kind {
+    JOB_ZCR,
+    JOB_RMS,
+    JOB_ENVELOPE,
+    JOB_FUSED
+};
+
+// A frame range split in contiguous chunks, one chunk per task
+struct frames_job {
+    enum frames_job_kind kind;
+    const int16_t *samples;
+    size_t N;
+    size_t frame_length;
+    size_t hop_length;
+    size_t pad;
+    size_t n_frames;
+    size_t chunk;
+    unsigned features;
+    float *out;                    // JOB_ZCR, JOB_RMS, JOB_ENVELOPE
+    const struct feature_set *set; // JOB_FUSED
+    int failed;                    // set (atomically) when a chunk could not allocate its scratch
+};
+
+static void frames_job_task(void *ctx, size_t index)
+{
+    struct frames_job *job = ctx;
+    size_t f0 = index * job->chunk;
+    size_t f1 = f0 + job->chunk < job->n_frames ? f0 + job->chunk : job->n_frames;
+
+    switch (job->kind)
+    {
+    case JOB_ZCR:
+        zcr_frames(job->samples, job->N, job->frame_length, job->hop_length, job->pad, f0, f1, job->out + f0);
+        break;
+    case JOB_RMS:
+        rms_frames(job->samples, job->N, job->frame_length, job->hop_length, job->pad, f0, f1, job->out + f0);
+        break;
+    case JOB_ENVELOPE:
+        if (envelope_frames(job->samples, job->N, job->frame_length, job->hop_length, job->pad, f0, f1, job->out + f0) != ERR_OK)
+            __atomic_store_n(&job->failed, TRUE, __ATOMIC_RELAXED);
+        break;
+    case JOB_FUSED:
+        fused_frames(job->samples, job->N, job->frame_length, job->hop_length, job->pad, job->features, f0, f1, job->set);
+        break;
+    }
+}
+
+// Splits the frames of job across the pool, or runs them inline for small inputs / no pool
+static ErrorCode frames_job_execute(struct thread_pool *pool, struct frames_job *job)
+{
+    size_t threads = thread_pool_size(pool);
+    if (threads > 1 && job->n_frames >= threads * PARALLEL_MIN_FRAMES_PER_THREAD)
+    {
+        // Quelques tâches par thread pour équilibrer la charge sans multiplier les réveils
+        size_t n_tasks = threads * 4;
+        job->chunk = (job->n_frames + n_tasks - 1) / n_tasks;
+        n_tasks = (job->n_frames + job->chunk - 1) / job->chunk;
+        thread_pool_run(pool, n_tasks, frames_job_task, job);
+    }
+    else
+    {
+        job->chunk = job->n_frames;
+        frames_job_task(job, 0);
+    }
+    return job->failed ? ERR_OUT_OF_MEMORY : ERR_OK;
+}
+
+static const char *const single_feature_invalid_msg[] = {
+    [JOB_ZCR] = "zero_crossing_rate_mt: invalid argument",
+    [JOB_RMS] = "rms_mt: invalid argument",
+    [JOB_ENVELOPE] = "amplitude_envelope_mt: invalid argument",
+};
+
+static const char *const single_feature_oom_msg[] = {
+    [JOB_ZCR] = "zero_crossing_rate_mt: allocation failed",
+    [JOB_RMS] = "rms_mt: allocation failed",
+    [JOB_ENVELOPE] = "amplitude_envelope_mt: allocation failed",
+};
+
+// Common body of the single-feature *_mt variants
+static ErrorCode single_feature_mt(struct thread_pool *pool, enum frames_job_kind kind,
+                                   const int16_t *samples, size_t N, size_t frame_length, size_t hop_length,
+                                   int center, float **out, size_t *n_frames_out)
+{
+    size_t min_frame_length = kind == JOB_ZCR ? 2 : 1;
+    if ((!samples && N > 0) || !out || !n_frames_out || frame_length < min_frame_length || hop_length == 0)
+    {
+        set_error(ERR_INVALID_ARG, single_feature_invalid_msg[kind]);
+        return ERR_INVALID_ARG;
+    }
+
+    struct frames_job job = {0};
+    job.kind = kind;
+    job.samples = samples;
+    job.N = N;
+    job.frame_length = frame_length;
+    job.hop_length = hop_length;
+    job.pad = center ? frame_length / 2 : 0;
+    job.n_frames = frame_count(N, frame_length, hop_length, center);
+
+    *n_frames_out = job.n_frames;
+    *out = NULL;
+    if (job.n_frames == 0)
+        return ERR_OK;
+
+    job.out = malloc(job.n_frames * sizeof(float));
+    if (!job.out || frames_job_execute(pool, &job) != ERR_OK)
+    {
+        free(job.out);
+        set_error(ERR_OUT_OF_MEMORY, single_feature_oom_msg[kind]);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    *out = job.out;
+    return ERR_OK;
+}
+
+/**
+ * Same as zero_crossing_rate, with the frame range split across the threads of pool.
+ * pool may be NULL, and small inputs run on the calling thread only.
+ */
+ErrorCode zero_crossing_rate_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length,
+                                size_t hop_length, int center, float **zcr_out, size_t *n_frames_out)
+{
+    return single_feature_mt(pool, JOB_ZCR, samples, N, frame_length, hop_length, center, zcr_out, n_frames_out);
+}
+
+// Same as rms, split across the threads of pool (see zero_crossing_rate_mt)
+ErrorCode rms_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length,
+                 size_t hop_length, int center, float **rms_out, size_t *n_frames_out)
+{
+    return single_feature_mt(pool, JOB_RMS, samples, N, frame_length, hop_length, center, rms_out, n_frames_out);
+}
+
+// Same as amplitude_envelope, split across the threads of pool (see zero_crossing_rate_mt)
+ErrorCode amplitude_envelope_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length,
+                                size_t hop_length, int center, float **envelope_out, size_t *n_frames_out)
+{
+    return single_feature_mt(pool, JOB_ENVELOPE, samples, N, frame_length, hop_length, center, envelope_out, n_frames_out);
+}
+
+// Same as extract_features, split across the threads of pool (see zero_crossing_rate_mt)
+ErrorCode extract_features_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length,
+                              size_t hop_length, int center, unsigned features, struct feature_set *out)
+{
+    if ((!samples && N > 0) || !out || frame_length < 2 || hop_length == 0 ||
+        features == 0 || (features & ~(unsigned)FEATURE_ALL) != 0)
+    {
+        set_error(ERR_INVALID_ARG, "extract_features_mt: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    struct frames_job job = {0};
+    job.kind = JOB_FUSED;
+    job.samples = samples;
+    job.N = N;
+    job.frame_length = frame_length;
+    job.hop_length = hop_length;
+    job.pad = center ? frame_length / 2 : 0;
+    job.n_frames = frame_count(N, frame_length, hop_length, center);
+    job.features = features;
+    job.set = out;
+
+    out->n_frames = job.n_frames;
+    if (job.n_frames == 0)
+        return ERR_OK;
+
+    if (feature_set_alloc(out, features, job.n_frames) != ERR_OK)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "extract_features_mt: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    return frames_job_execute(pool, &job);
+}
+
+// ########################################## BATCH ##########################################
+
+struct batch_job {
+    const char *const *paths;
+    const struct feature_spec *spec;
+    struct file_result *results;
+};
+
+
+// Loads and analyzes one file; each worker runs whole files, so I/O of one overlaps compute of another
+static void batch_job_task(void *ctx, size_t index)
+{
+    struct batch_job *job = ctx;
+    const struct feature_spec *spec = job->spec;
+    struct file_result *res = &job->results[index];
+    struct wav_mapping map;
+
+    ErrorCode rc = probe_wav_file(job->paths[index], &res->header);
+    if (rc != ERR_OK)
+    {
+        res->status = rc;
+        res->message = last_error_message();
+        return;
+    }
+
+    // Les features sont calculées sur le signal mono : un fichier mono est lu sans copie via mmap,
+    // les autres sont moyennés pendant le décodage, sans jamais allouer tous les canaux
+    const int16_t *mono = NULL;
+    void *mixed = NULL;
+    int mapped = res->header.num_channels == 1;
+    if (mapped)
+    {
+        rc = retrieve_wav_data_mmap(job->paths[index], &map);
+        if (rc == ERR_OK)
+        {
+            mono = map.samples;
+            res->frames = map.frames;
+        }
+    }
+    else
+    {
+        const struct channel_selection downmix = {CHANNELS_DOWNMIX, NULL, 0};
+        rc = retrieve_wav_data_channels(job->paths[index], SAMPLE_S16, &downmix, &res->header, &mixed,
+                                        &res->frames, NULL);
+        mono = mixed;
+    }
+    if (rc != ERR_OK)
+    {
+        res->status = rc;
+        res->message = last_error_message();
+        return;
+    }
+
+    rc = extract_features(mono, res->frames, spec->frame_length, spec->hop_length, spec->center,
+                          spec->features, &res->features);
+    res->status = rc;
+    res->message = rc == ERR_OK ? NULL : last_error_message();
+
+    if (mapped)
+        release_wav_data_mmap(&map);
+    else
+        free(mixed);
+}
+
+/**
+ * Loads and analyzes a list of WAV files concurrently: every thread of pool takes whole files, so that
+ * the decoding of some files overlaps the analysis of others. For I/O-bound corpora the pool can be
+ * created with more threads than cores. Multichannel files are averaged to mono before analysis.
+ * A failing file does not stop the batch: its status and message are set in its result.
+ * @param pool Thread pool (NULL runs the files one after the other on the calling thread)
+ * @param paths Paths of the files
+ * @param n_paths Number of files
+ * @param spec Features and framing to compute for every file
+ * @param results Array of n_paths results, filled in path order; release with file_results_free
+ * @return ERR_OK when the batch ran (check every results[i].status), or ERR_INVALID_ARG
+ */
+ErrorCode analyze_files(struct thread_pool *pool, const char *const *paths, size_t n_paths,
+                        const struct feature_spec *spec, struct file_result *results)
+{
+    if ((!paths && n_paths > 0) || !spec || (!results && n_paths > 0) || spec->frame_length < 2 ||
+        spec->hop_length == 0 || spec->features == 0 || (spec->features & ~(unsigned)FEATURE_ALL) != 0)
+    {
+        set_error(ERR_INVALID_ARG, "analyze_files: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    memset(results, 0, n_paths * sizeof *results);
+    struct batch_job job = {paths, spec, results};
+
+    if (thread_pool_size(pool) > 1 && n_paths > 1)
+        thread_pool_run(pool, n_paths, batch_job_task, &job);
+    else
+        for (size_t i = 0; i < n_paths; ++i)
+            batch_job_task(&job, i);
+
+    return ERR_OK;
+}
+
+void file_results_free(struct file_result *results, size_t n_paths)
+{
+    if (!results)
+        return;
+    for (size_t i = 0; i < n_paths; ++i)
+    {
+        free(results[i].features.zcr);
+        free(results[i].features.rms);
+        free(results[i].features.envelope);
+        memset(&results[i].features, 0, sizeof results[i].features);
+    }
+}
+
+// ########################################## PLANAR ##########################################
+
+/**
+ * Splits interleaved samples into one contiguous run per channel (structure of arrays)
+ * @param interleaved frames * channels interleaved samples
+ * @param frames Number of frames
+ * @param channels Number of channels (>= 1)
+ * @param out Receives the planar buffer, to release with planar_audio_free
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode deinterleave_s16(const int16_t *interleaved, uint64_t frames, uint16_t channels, struct planar_audio *out)
+{
+    if ((!interleaved && frames > 0) || !out || channels == 0)
+    {
+        set_error(ERR_INVALID_ARG, "deinterleave_s16: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+    if (frames > SIZE_MAX / sizeof(int16_t) / channels)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "deinterleave_s16: samples do not fit in memory");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    size_t n = (size_t)frames;
+    int16_t *data = malloc((n > 0 ? n : 1) * channels * sizeof *data);
+    if (!data)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "deinterleave_s16: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    if (channels == 1)
+        memcpy(data, interleaved, n * sizeof *data);
+    else if (channels == 2)
+        kernels()->deinterleave2_i16(interleaved, n, data, data + n);
+    else
+        for (uint16_t ch = 0; ch < channels; ++ch)
+        {
+            int16_t *plane = data + (size_t)ch * n;
+            for (size_t f = 0; f < n; ++f)
+                plane[f] = interleaved[f * channels + ch];
+        }
+
+    out->data = data;
+    out->channels = channels;
+    out->frames = frames;
+    return ERR_OK;
+}
+
+/**
+ * Loads a WAV file (any supported encoding, decoded to int16) straight into a planar buffer.
+ * 16-bit files are read through retrieve_wav_data_mmap, so the only copy made is the planar one.
+ * @param filename Path of the WAV file
+ * @param out_wh Receives the parsed header
+ * @param out Receives the planar buffer, to release with planar_audio_free
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode retrieve_wav_data_planar(const char *filename, struct wav_header *out_wh, struct planar_audio *out)
+{
+    if (!filename || !out_wh || !out)
+    {
+        set_error(ERR_INVALID_ARG, "retrieve_wav_data_planar: null argument");
+        return ERR_INVALID_ARG;
+    }
+
+    struct wav_mapping map;
+    ErrorCode rc = retrieve_wav_data_mmap(filename, &map);
+    if (rc != ERR_OK)
+        return rc;
+
+    *out_wh = map.header;
+    rc = deinterleave_s16(map.samples, map.frames, map.header.num_channels, out);
+    release_wav_data_mmap(&map);
+    return rc;
+}
+
+void planar_audio_free(struct planar_audio *audio)
+{
+    if (!audio)
+        return;
+    free(audio->data);
+    memset(audio, 0, sizeof(*audio));
+}
+
+/**
+ * Computes the features of every channel of a planar signal. Each output array holds one row of
+ * out->n_frames values per channel: row c starts at c * out->n_frames.
+ * Each requested array left NULL in out is malloc'ed; a non-NULL one is used as is and must hold
+ * channels * feature_frame_count(frames, frame_length, hop_length, center) values.
+ * @param pool Thread pool splitting the frames of each channel (NULL runs in the calling thread)
+ * @param audio Planar samples
+ * @param frame_length Number of samples per frame (>= 2)
+ * @param hop_length Number of samples between two frame starts (> 0)
+ * @param center Non-zero to pad frame_length / 2 zeros on both sides
+ * @param features Bitmask of FeatureFlags
+ * @param out Output arrays, out->n_frames receives the number of frames per channel
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode extract_features_planar(struct thread_pool *pool, const struct planar_audio *audio, size_t frame_length,
+                                  size_t hop_length, int center, unsigned features, struct feature_set *out)
+{
+    if (!audio || (!audio->data && audio->frames > 0) || audio->channels == 0 || !out || frame_length < 2 ||
+        hop_length == 0 || features == 0 || (features & ~(unsigned)FEATURE_ALL) != 0)
+    {
+        set_error(ERR_INVALID_ARG, "extract_features_planar: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    size_t N = (size_t)audio->frames;
+    size_t n_frames = frame_count(N, frame_length, hop_length, center);
+    out->n_frames = n_frames;
+    if (n_frames == 0)
+        return ERR_OK;
+
+    struct feature_set caller = *out;
+    if (n_frames > SIZE_MAX / sizeof(float) / audio->channels ||
+        feature_set_alloc(out, features, n_frames * audio->channels) != ERR_OK)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "extract_features_planar: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    for (uint16_t ch = 0; ch < audio->channels; ++ch)
+    {
+        // Lignes déjà allouées : extract_features_mt écrit directement dedans
+        size_t row = (size_t)ch * n_frames;
+        struct feature_set rows = {
+            (features & FEATURE_ZCR) ? out->zcr + row : NULL,
+            (features & FEATURE_RMS) ? out->rms + row : NULL,
+            (features & FEATURE_ENVELOPE) ? out->envelope + row : NULL,
+            0,
+        };
+        ErrorCode rc = extract_features_mt(pool, audio->data + (size_t)ch * N, N, frame_length, hop_length, center,
+                                          features, &rows);
+        if (rc != ERR_OK)
+        {
+            // On ne libère que ce que l'on a alloué
+            if (out->zcr != caller.zcr)
+                free(out->zcr);
+            if (out->rms != caller.rms)
+                free(out->rms);
+            if (out->envelope != caller.envelope)
+                free(out->envelope);
+            *out = caller;
+            return rc;
+        }
+    }
+    return ERR_OK;
+}
+
+// ########################################## STREAMING ##########################################
+
+// Streaming context: keeps at most one frame of samples between pushes
+struct feature_stream {
+    size_t frame_length;
+    size_t hop_length;
+    size_t pad;       // number of zeros appended on flush when center != 0
+    int16_t *frame;   // current (possibly partial) frame, frame_length samples
+    size_t fill;      // number of valid samples in frame
+    size_t skip;      // samples still to drop before the next frame starts (hop_length > frame_length)
+    int finished;     // set once feature_stream_flush has been called
+};
+
+/**
+ * Creates a streaming context producing the same frames as zero_crossing_rate on the concatenation of
+ * every pushed buffer. With center != 0, frame_length / 2 zeros are virtually prepended now and
+ * appended by feature_stream_flush, exactly like the batch padding.
+ * @param frame_length Number of samples per frame (>= 2)
+ * @param hop_length Number of samples between two frame starts (> 0)
+ * @param center Non-zero to center frames on their sample index
+ * @param out_stream Receives the new context, to release with feature_stream_free
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode feature_stream_create(size_t frame_length, size_t hop_length, int center, struct feature_stream **out_stream)
+{
+    if (!out_stream || frame_length < 2 || hop_length == 0)
+    {
+        set_error(ERR_INVALID_ARG, "feature_stream_create: invalid frame_length/hop_length");
+        return ERR_INVALID_ARG;
+    }
+
+    struct feature_stream *st = calloc(1, sizeof *st);
+    int16_t *frame = calloc(frame_length, sizeof *frame);
+    if (!st || !frame)
+    {
+        free(st);
+        free(frame);
+        set_error(ERR_OUT_OF_MEMORY, "feature_stream_create: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    st->frame_length = frame_length;
+    st->hop_length = hop_length;
+    st->pad = center ? frame_length / 2 : 0;
+    st->frame = frame;
+    // Leading padding: the buffer is already zeroed, we only account for it
+    st->fill = st->pad;
+
+    *out_stream = st;
+    return ERR_OK;
+}
+
+// Appends samples to the stream and writes every frame they complete into out (returns the frame count)
+static size_t feature_stream_feed(struct feature_stream *st, const int16_t *samples, size_t n, float *out)
+{
+    const size_t frame_length = st->frame_length;
+    const size_t hop_length = st->hop_length;
+    size_t produced = 0;
+
+    while (n > 0)
+    {
+        if (st->skip > 0)
+        {
+            size_t k = st->skip < n ? st->skip : n;
+            st->skip -= k;
+            n -= k;
+            if (samples)
+                samples += k;
+            continue;
+        }
+
+        size_t take = frame_length - st->fill;
+        if (take > n)
+            take = n;
+        // samples == NULL stands for a run of zeros (trailing padding)
+        if (samples)
+        {
+            memcpy(st->frame + st->fill, samples, take * sizeof *samples);
+            samples += take;
+        }
+        else
+            memset(st->frame + st->fill, 0, take * sizeof *st->frame);
+        st->fill += take;
+        n -= take;
+
+        if (st->fill < frame_length)
+            break;
+
+        out[produced++] = zcr_from_count(zcr_count(st->frame, frame_length), frame_length);
+
+        if (hop_length < frame_length)
+        {
+            // Keep the overlap with the next frame
+            memmove(st->frame, st->frame + hop_length, (frame_length - hop_length) * sizeof *st->frame);
+            st->fill = frame_length - hop_length;
+        }
+        else
+        {
+            st->fill = 0;
+            st->skip = hop_length - frame_length;
+        }
+    }
+    return produced;
+}
+
+// Shared by push and flush: allocates the output for at most (fill + n) / hop_length + 1 frames
+static ErrorCode feature_stream_emit(struct feature_stream *st, const int16_t *samples, size_t n,
+                                     float **zcr_out, size_t *n_frames_out)
+{
+    size_t max_frames = (st->fill + n) / st->hop_length + 1;
+    float *buf = malloc(max_frames * sizeof *buf);
+    if (!buf)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "feature_stream: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    size_t produced = feature_stream_feed(st, samples, n, buf);
+    if (produced == 0)
+    {
+        free(buf);
+        buf = NULL;
+    }
+
+    *zcr_out = buf;
+    *n_frames_out = produced;
+    return ERR_OK;
+}
+
+/**
+ * Pushes an arbitrary number of samples and returns the ZCR of every frame completed by this push
+ * @param st Streaming context
+ * @param samples Samples to append (may be NULL when n == 0)
+ * @param n Number of samples
+ * @param zcr_out Receives a malloc'ed array of n_frames_out values (NULL when no frame completed)
+ * @param n_frames_out Receives the number of frames produced by this push
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode feature_stream_push(struct feature_stream *st, const int16_t *samples, size_t n,
+                              float **zcr_out, size_t *n_frames_out)
+{
+    if (!st || (!samples && n > 0) || !zcr_out || !n_frames_out)
+    {
+        set_error(ERR_INVALID_ARG, "feature_stream_push: null argument");
+        return ERR_INVALID_ARG;
+    }
+    if (st->finished)
+    {
+        set_error(ERR_INVALID_ARG, "feature_stream_push: stream already flushed");
+        return ERR_INVALID_ARG;
+    }
+    return feature_stream_emit(st, samples, n, zcr_out, n_frames_out);
+}
+
+/**
+ * Ends the stream: appends the trailing padding (center mode) and returns the last frames.
+ * A trailing partial frame is dropped, like in zero_crossing_rate.
+ * @param st Streaming context
+ * @param zcr_out Receives a malloc'ed array of n_frames_out values (NULL when no frame completed)
+ * @param n_frames_out Receives the number of frames produced
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode feature_stream_flush(struct feature_stream *st, float **zcr_out, size_t *n_frames_out)
+{
+    if (!st || !zcr_out || !n_frames_out)
+    {
+        set_error(ERR_INVALID_ARG, "feature_stream_flush: null argument");
+        return ERR_INVALID_ARG;
+    }
+    if (st->finished)
+    {
+        *zcr_out = NULL;
+        *n_frames_out = 0;
+        return ERR_OK;
+    }
+    st->finished = TRUE;
+    return feature_stream_emit(st, NULL, st->pad, zcr_out, n_frames_out);
+}
+
+void feature_stream_free(struct feature_stream *st)
+{
+    if (!st)
+        return;
+    free(st->frame);
+    free(st);
+}
+
+// ########################################## SPECTRAL ##########################################
+
+// Complex value of the FFT, laid out as the (re, im) pairs of the public spectra
+struct fft_cpx {
+    float re;
+    float im;
+};
+
+#define FFT_MAX_FACTORS 32
+
+// Immutable once built: a plan is shared by every thread through the plan cache
+struct fft_plan {
+    size_t n;                            // real transform size
+    size_t m;                            // complex transform size: n / 2 when n is even, n otherwise
+    size_t factors[2 * FFT_MAX_FACTORS]; // (radix, remaining length) pairs, 0-terminated
+    size_t max_radix;
+    struct fft_cpx *twiddles;            // exp(-2i pi k / m), k < m
+    struct fft_cpx *super;               // even n only: exp(-i pi ((k + 1) / m + 1/2)), k < m / 2
+    WindowType window;
+    float *win;                          // periodic window of n samples, as scipy.signal.get_window
+    struct fft_plan *next;
+};
+
+// Protects plan_cache, mel_cache (see MEL) and resample_cache (see RESAMPLING)
+static pthread_mutex_t plan_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct fft_plan *plan_cache = NULL;
+static struct mel_bank *mel_cache = NULL;
+static struct resample_filter *resample_cache = NULL;
+
+static inline struct fft_cpx cpx_mul(struct fft_cpx a, struct fft_cpx b)
+{
+    struct fft_cpx r = {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+    return r;
+}
+
+// Radix 4 first, then 2, 3 and odd numbers; a prime factor larger than sqrt(n) ends the list
+static int fft_factorize(size_t n, size_t *factors, size_t *max_radix)
+{
+    size_t p = 4, k = 0;
+    *max_radix = 1;
+    while (n > 1)
+    {
+        while (n % p)
+        {
+            p = p == 4 ? 2 : p == 2 ? 3 : p + 2;
+            if (p * p > n)
+                p = n;
+        }
+        if (k == FFT_MAX_FACTORS - 1)
+            return -1;
+        n /= p;
+        factors[2 * k] = p;
+        factors[2 * k + 1] = n;
+        if (p > *max_radix)
+            *max_radix = p;
+        ++k;
+    }
+    factors[2 * k] = 0;
+    return 0;
+}
+
+static void fft_plan_free(struct fft_plan *plan)
+{
+    if (!plan)
+        return;
+    free(plan->twiddles);
+    free(plan->super);
+    free(plan->win);
+    free(plan);
+}
+
+static struct fft_plan *fft_plan_new(size_t n, WindowType window)
+{
+    struct fft_plan *plan = calloc(1, sizeof *plan);
+    if (!plan)
+        return NULL;
+    plan->n = n;
+    plan->m = n % 2 == 0 ? n / 2 : n;
+    plan->window = window;
+    plan->twiddles = malloc(plan->m * sizeof *plan->twiddles);
+    plan->super = malloc((plan->m / 2 + 1) * sizeof *plan->super);
+    plan->win = malloc(n * sizeof *plan->win);
+    if (!plan->twiddles || !plan->super || !plan->win || fft_factorize(plan->m, plan->factors, &plan->max_radix) != 0)
+    {
+        fft_plan_free(plan);
+        return NULL;
+    }
+
+    // Calculés en double puis arrondis une seule fois
+    for (size_t k = 0; k < plan->m; ++k)
+    {
+        double phase = -2.0 * M_PI * (double)k / (double)plan->m;
+        plan->twiddles[k].re = (float)cos(phase);
+        plan->twiddles[k].im = (float)sin(phase);
+    }
+    for (size_t k = 0; n % 2 == 0 && k < plan->m / 2; ++k)
+    {
+        double phase = -M_PI * ((double)(k + 1) / (double)plan->m + 0.5);
+        plan->super[k].re = (float)cos(phase);
+        plan->super[k].im = (float)sin(phase);
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        double c = cos(2.0 * M_PI * (double)i / (double)n);
+        plan->win[i] = window == WINDOW_HANN      ? (float)(0.5 - 0.5 * c)
+                       : window == WINDOW_HAMMING ? (float)(0.54 - 0.46 * c)
+                                                  : 1.0f;
+    }
+    return plan;
+}
+
+// Returns the cached plan of (n, window), building it on first use
+static const struct fft_plan *fft_plan_get(size_t n, WindowType window)
+{
+    pthread_mutex_lock(&plan_cache_lock);
+    struct fft_plan *plan = plan_cache;
+    while (plan && (plan->n != n || plan->window != window))
+        plan = plan->next;
+    if (!plan)
+    {
+        plan = fft_plan_new(n, window);
+        if (plan)
+        {
+            plan->next = plan_cache;
+            plan_cache = plan;
+        }
+    }
+    pthread_mutex_unlock(&plan_cache_lock);
+    return plan;
+}
+
+/**
+ * Releases every cached FFT plan, mel filterbank and resampling filter bank. Filter banks still used by a
+ * resampler are kept until a later call. Only call it when no spectral function is running in another thread.
+ */
+void fft_plan_cache_clear(void)
+{
+    pthread_mutex_lock(&plan_cache_lock);
+    while (plan_cache)
+    {
+        struct fft_plan *next = plan_cache->next;
+        fft_plan_free(plan_cache);
+        plan_cache = next;
+    }
+    while (mel_cache)
+        mel_cache = mel_bank_free(mel_cache);
+    resample_cache_prune();
+    pthread_mutex_unlock(&plan_cache_lock);
+}
+
+static void fft_bfly2(struct fft_cpx *out, size_t fstride, const struct fft_plan *plan, size_t m)
+{
+    struct fft_cpx *out2 = out + m;
+    for (size_t k = 0; k < m; ++k)
+    {
+        struct fft_cpx t = cpx_mul(out2[k], plan->twiddles[k * fstride]);
+        out2[k].re = out[k].re - t.re;
+        out2[k].im = out[k].im - t.im;
+        out[k].re += t.re;
+        out[k].im += t.im;
+    }
+}
+
+static void fft_bfly3(struct fft_cpx *out, size_t fstride, const struct fft_plan *plan, size_t m)
+{
+    const float epi3 = plan->twiddles[fstride * m].im; // sin(-2 pi / 3)
+    for (size_t k = 0; k < m; ++k)
+    {
+        struct fft_cpx s1 = cpx_mul(out[k + m], plan->twiddles[k * fstride]);
+        struct fft_cpx s2 = cpx_mul(out[k + 2 * m], plan->twiddles[2 * k * fstride]);
+        struct fft_cpx s3 = {s1.re + s2.re, s1.im + s2.im};
+        struct fft_cpx s0 = {(s1.re - s2.re) * epi3, (s1.im - s2.im) * epi3};
+
+        struct fft_cpx mid = {out[k].re - 0.5f * s3.re, out[k].im - 0.5f * s3.im};
+        out[k].re += s3.re;
+        out[k].im += s3.im;
+        out[k + 2 * m].re = mid.re + s0.im;
+        out[k + 2 * m].im = mid.im - s0.re;
+        out[k + m].re = mid.re - s0.im;
+        out[k + m].im = mid.im + s0.re;
+    }
+}
+
+static void fft_bfly4(struct fft_cpx *out, size_t fstride, const struct fft_plan *plan, size_t m)
+{
+    for (size_t k = 0; k < m; ++k)
+    {
+        struct fft_cpx s0 = cpx_mul(out[k + m], plan->twiddles[k * fstride]);
+        struct fft_cpx s1 = cpx_mul(out[k + 2 * m], plan->twiddles[2 * k * fstride]);
+        struct fft_cpx s2 = cpx_mul(out[k + 3 * m], plan->twiddles[3 * k * fstride]);
+
+        struct fft_cpx s5 = {out[k].re - s1.re, out[k].im - s1.im};
+        struct fft_cpx a = {out[k].re + s1.re, out[k].im + s1.im};
+        struct fft_cpx s3 = {s0.re + s2.re, s0.im + s2.im};
+        struct fft_cpx s4 = {s0.re - s2.re, s0.im - s2.im};
+
+        out[k + 2 * m].re = a.re - s3.re;
+        out[k + 2 * m].im = a.im - s3.im;
+        out[k].re = a.re + s3.re;
+        out[k].im = a.im + s3.im;
+        out[k + m].re = s5.re + s4.im;
+        out[k + m].im = s5.im - s4.re;
+        out[k + 3 * m].re = s5.re - s4.im;
+        out[k + 3 * m].im = s5.im + s4.re;
+    }
+}
+
+// Any radix p, O(p^2) per group: only used for prime factors other than 2 and 3
+static void fft_bfly_generic(struct fft_cpx *out, size_t fstride, const struct fft_plan *plan, size_t m, size_t p,
+                             struct fft_cpx *scratch)
+{
+    const size_t n = plan->m;
+    for (size_t u = 0; u < m; ++u)
+    {
+        for (size_t q = 0; q < p; ++q)
+            scratch[q] = out[u + q * m];
+
+        for (size_t q1 = 0, k = u; q1 < p; ++q1, k += m)
+        {
+            size_t twidx = 0;
+            struct fft_cpx acc = scratch[0];
+            for (size_t q = 1; q < p; ++q)
+            {
+                twidx += fstride * k;
+                if (twidx >= n)
+                    twidx %= n;
+                struct fft_cpx t = cpx_mul(scratch[q], plan->twiddles[twidx]);
+                acc.re += t.re;
+                acc.im += t.im;
+            }
+            out[k] = acc;
+        }
+    }
+}
+
+// Decimation in time over the factor list: out[0 .. p*m) receives the DFT of in[0], in[fstride], ...
+static void fft_work(struct fft_cpx *out, const struct fft_cpx *in, size_t fstride, const size_t *factors,
+                     const struct fft_plan *plan, struct fft_cpx *scratch)
+{
+    const size_t p = factors[0];
+    const size_t m = factors[1];
+
+    if (m == 1)
+        for (size_t q = 0; q < p; ++q)
+            out[q] = in[q * fstride];
+    else
+        for (size_t q = 0; q < p; ++q)
+            fft_work(out + q * m, in + q * fstride, fstride * p, factors + 2, plan, scratch);
+
+    switch (p)
+    {
+    case 2:
+        fft_bfly2(out, fstride, plan, m);
+        break;
+    case 3:
+        fft_bfly3(out, fstride, plan, m);
+        break;
+    case 4:
+        fft_bfly4(out, fstride, plan, m);
+        break;
+    default:
+        fft_bfly_generic(out, fstride, plan, m, p, scratch);
+        break;
+    }
+}
+
+// Forward complex DFT of plan->m points (in and out must not overlap)
+static void fft_complex(const struct fft_plan *plan, const struct fft_cpx *in, struct fft_cpx *out,
+                        struct fft_cpx *scratch)
+{
+    if (plan->m == 1)
+        out[0] = in[0];
+    else
+        fft_work(out, in, 1, plan->factors, plan, scratch);
+}
+
+// Number of fft_cpx of work memory needed by rfft_exec / irfft_exec
+static size_t fft_work_size(const struct fft_plan *plan)
+{
+    return 2 * plan->m + plan->max_radix;
+}
+
+/**
+ * Real forward transform: packs x into plan->m complex values, runs the complex FFT and splits the
+ * result into the n / 2 + 1 non-negative frequency bins (out).
+ */
+static void rfft_exec(const struct fft_plan *plan, const float *x, struct fft_cpx *out, struct fft_cpx *work)
+{
+    const size_t m = plan->m;
+    struct fft_cpx *z = work, *Z = work + m, *scratch = work + 2 * m;
+
+    if (plan->n % 2 != 0)
+    {
+        for (size_t k = 0; k < m; ++k)
+        {
+            z[k].re = x[k];
+            z[k].im = 0.0f;
+        }
+        fft_complex(plan, z, Z, scratch);
+        memcpy(out, Z, (plan->n / 2 + 1) * sizeof *out);
+        return;
+    }
+
+    // Échantillons pairs en partie réelle, impairs en partie imaginaire
+    for (size_t k = 0; k < m; ++k)
+    {
+        z[k].re = x[2 * k];
+        z[k].im = x[2 * k + 1];
+    }
+    fft_complex(plan, z, Z, scratch);
+
+    out[0].re = Z[0].re + Z[0].im;
+    out[0].im = 0.0f;
+    out[m].re = Z[0].re - Z[0].im;
+    out[m].im = 0.0f;
+    for (size_t k = 1; k <= m / 2; ++k)
+    {
+        struct fft_cpx fpk = Z[k];
+        struct fft_cpx fpnk = {Z[m - k].re, -Z[m - k].im};
+        struct fft_cpx f1k = {fpk.re + fpnk.re, fpk.im + fpnk.im};
+        struct fft_cpx f2k = {fpk.re - fpnk.re, fpk.im - fpnk.im};
+        struct fft_cpx tw = cpx_mul(f2k, plan->super[k - 1]);
+
+        out[k].re = 0.5f * (f1k.re + tw.re);
+        out[k].im = 0.5f * (f1k.im + tw.im);
+        out[m - k].re = 0.5f * (f1k.re - tw.re);
+        out[m - k].im = 0.5f * (tw.im - f1k.im);
+    }
+}
+
+/**
+ * Real inverse transform of n / 2 + 1 bins, scaled by 1 / n so that irfft(rfft(x)) == x.
+ * The inverse complex DFT is the forward one applied to conjugates.
+ */
+static void irfft_exec(const struct fft_plan *plan, const struct fft_cpx *in, float *x, struct fft_cpx *work)
+{
+    const size_t m = plan->m;
+    const float scale = 1.0f / (float)plan->n;
+    struct fft_cpx *z = work, *Z = work + m, *scratch = work + 2 * m;
+
+    if (plan->n % 2 != 0)
+    {
+        // Spectre hermitien complet, conjugué pour la transformée directe
+        for (size_t k = 0; k <= m / 2; ++k)
+        {
+            z[k].re = in[k].re;
+            z[k].im = -in[k].im;
+            if (k > 0)
+            {
+                z[m - k].re = in[k].re;
+                z[m - k].im = in[k].im;
+            }
+        }
+        fft_complex(plan, z, Z, scratch);
+        for (size_t k = 0; k < m; ++k)
+            x[k] = Z[k].re * scale;
+        return;
+    }
+
+    z[0].re = in[0].re + in[m].re;
+    z[0].im = -(in[0].re - in[m].re);
+    for (size_t k = 1; k <= m / 2; ++k)
+    {
+        struct fft_cpx fk = in[k];
+        struct fft_cpx fnkc = {in[m - k].re, -in[m - k].im};
+        struct fft_cpx fek = {fk.re + fnkc.re, fk.im + fnkc.im};
+        struct fft_cpx tmp = {fk.re - fnkc.re, fk.im - fnkc.im};
+        struct fft_cpx tw = {plan->super[k - 1].re, -plan->super[k - 1].im};
+        struct fft_cpx fok = cpx_mul(tmp, tw);
+
+        // z = conj(tmpbuf)
+        z[k].re = fek.re + fok.re;
+        z[k].im = -(fek.im + fok.im);
+        z[m - k].re = fek.re - fok.re;
+        z[m - k].im = fek.im - fok.im;
+    }
+    fft_complex(plan, z, Z, scratch);
+    for (size_t k = 0; k < m; ++k)
+    {
+        x[2 * k] = Z[k].re * scale;
+        x[2 * k + 1] = -Z[k].im * scale;
+    }
+}
+
+/**
+ * Forward real FFT of any length n (mixed radix 4/2/3 with a generic odd radix), using the cached plan of n
+ * @param x n real samples
+ * @param n Transform size (>= 1)
+ * @param spectrum_out Receives n / 2 + 1 complex bins as (re, im) pairs
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode rfft(const float *x, size_t n, float *spectrum_out)
+{
+    if (!x || !spectrum_out || n == 0)
+    {
+        set_error(ERR_INVALID_ARG, "rfft: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+    const struct fft_plan *plan = fft_plan_get(n, WINDOW_RECTANGULAR);
+    struct fft_cpx *work = plan ? malloc(fft_work_size(plan) * sizeof *work) : NULL;
+    if (!work)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "rfft: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    rfft_exec(plan, x, (struct fft_cpx *)spectrum_out, work);
+    free(work);
+    return ERR_OK;
+}
+
+/**
+ * Inverse of rfft: n real samples from n / 2 + 1 complex bins, scaled by 1 / n
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode irfft(const float *spectrum, size_t n, float *x_out)
+{
+    if (!spectrum || !x_out || n == 0)
+    {
+        set_error(ERR_INVALID_ARG, "irfft: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+    const struct fft_plan *plan = fft_plan_get(n, WINDOW_RECTANGULAR);
+    struct fft_cpx *work = plan ? malloc(fft_work_size(plan) * sizeof *work) : NULL;
+    if (!work)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "irfft: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    irfft_exec(plan, (const struct fft_cpx *)spectrum, x_out, work);
+    free(work);
+    return ERR_OK;
+}
+
+// Windowed frame f in float (full scale = 1), zero outside the signal as with center padding
+static void stft_gather(const struct fft_plan *plan, const int16_t *samples, size_t N, size_t hop_length, size_t pad,
+                        size_t f, float *frame)
+{
+    const size_t n_fft = plan->n;
+    size_t start = f * hop_length;
+    for (size_t i = 0; i < n_fft; ++i)
+    {
+        size_t j = start + i; // indice paddé
+        float v = (j >= pad && j - pad < N) ? (float)samples[j - pad] * (1.0f / 32768.0f) : 0.0f;
+        frame[i] = v * plan->win[i];
+    }
+}
+
+// Fills frames [f0, f1) of a frame-major complex spectrum (n_bins bins per frame)
+static void stft_frames(const struct fft_plan *plan, const int16_t *samples, size_t N, size_t hop_length, size_t pad,
+                        size_t f0, size_t f1, struct fft_cpx *spectrum, float *frame, struct fft_cpx *work)
+{
+    const size_t n_bins = plan->n / 2 + 1;
+    for (size_t f = f0; f < f1; ++f)
+    {
+        stft_gather(plan, samples, N, hop_length, pad, f, frame);
+        rfft_exec(plan, frame, spectrum + (f - f0) * n_bins, work);
+    }
+}
+
+// |X|^power of the n_bins bins of frame f into row
+static void stft_power_row(const struct fft_plan *plan, const int16_t *samples, size_t N, size_t hop_length,
+                           size_t pad, size_t f, float power, float *row, float *frame, struct fft_cpx *bins,
+                           struct fft_cpx *work)
+{
+    const size_t n_bins = plan->n / 2 + 1;
+    stft_frames(plan, samples, N, hop_length, pad, f, f + 1, bins, frame, work);
+    for (size_t k = 0; k < n_bins; ++k)
+    {
+        float p2 = bins[k].re * bins[k].re + bins[k].im * bins[k].im;
+        // Cas courants sans pow
+        row[k] = power == 2.0f ? p2 : power == 1.0f ? sqrtf(p2) : powf(p2, 0.5f * power);
+    }
+}
+
+// Shared validation and plan/scratch setup of the spectral entry points
+static ErrorCode stft_setup(const char *name, const int16_t *samples, size_t N, size_t n_fft, size_t hop_length,
+                            int center, WindowType window, const struct fft_plan **plan, size_t *n_frames,
+                            float **frame, struct fft_cpx **work)
+{
+    if ((!samples && N > 0) || n_fft == 0 || hop_length == 0 ||
+        (window != WINDOW_HANN && window != WINDOW_HAMMING && window != WINDOW_RECTANGULAR))
+    {
+        set_error(ERR_INVALID_ARG, name);
+        return ERR_INVALID_ARG;
+    }
+
+    *n_frames = frame_count(N, n_fft, hop_length, center);
+    *plan = fft_plan_get(n_fft, window);
+    *frame = NULL;
+    *work = NULL;
+    if (*plan)
+    {
+        *frame = malloc(n_fft * sizeof **frame);
+        *work = malloc(fft_work_size(*plan) * sizeof **work);
+    }
+    if (!*frame || !*work)
+    {
+        free(*frame);
+        free(*work);
+        set_error(ERR_OUT_OF_MEMORY, "stft: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    return ERR_OK;
+}
+
+/**
+ * Computes the short-time Fourier transform of a signal, like librosa.stft on the float signal
+ * (samples / 32768) with window=window, pad_mode="constant". Frames follow the frame/hop/center semantics
+ * of zero_crossing_rate with frame_length = n_fft. FFT plans and windows are cached per (n_fft, window).
+ * The spectrum is frame-major: frame f holds n_bins (re, im) pairs starting at spectrum[2 * f * n_bins],
+ * i.e. the transpose of librosa's (n_bins, n_frames) matrix.
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param n_fft FFT size and frame length (any size >= 1, fastest for products of 2, 3 and 5)
+ * @param hop_length Number of samples between two frame starts (> 0)
+ * @param center Non-zero to pad n_fft / 2 zeros on both sides
+ * @param window WINDOW_HANN, WINDOW_HAMMING or WINDOW_RECTANGULAR
+ * @param spectrum_out Receives a malloc'ed array of n_frames_out * n_bins_out complex values (NULL when there is no frame)
+ * @param n_bins_out Receives n_fft / 2 + 1
+ * @param n_frames_out Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode stft(const int16_t *samples, size_t N, size_t n_fft, size_t hop_length, int center, WindowType window,
+               float **spectrum_out, size_t *n_bins_out, size_t *n_frames_out)
+{
+    if (!spectrum_out || !n_bins_out || !n_frames_out)
+    {
+        set_error(ERR_INVALID_ARG, "stft: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    const struct fft_plan *plan;
+    size_t n_frames;
+    float *frame;
+    struct fft_cpx *work;
+    ErrorCode rc = stft_setup("stft: invalid argument", samples, N, n_fft, hop_length, center, window, &plan,
+                              &n_frames, &frame, &work);
+    if (rc != ERR_OK)
+        return rc;
+
+    const size_t n_bins = n_fft / 2 + 1;
+    *n_bins_out = n_bins;
+    *n_frames_out = n_frames;
+    *spectrum_out = NULL;
+
+    if (n_frames > 0)
+    {
+        struct fft_cpx *spectrum = n_frames <= SIZE_MAX / sizeof *spectrum / n_bins
+                                       ? malloc(n_frames * n_bins * sizeof *spectrum)
+                                       : NULL;
+        if (!spectrum)
+        {
+            free(frame);
+            free(work);
+            set_error(ERR_OUT_OF_MEMORY, "stft: allocation failed");
+            return ERR_OUT_OF_MEMORY;
+        }
+        stft_frames(plan, samples, N, hop_length, center ? n_fft / 2 : 0, 0, n_frames, spectrum, frame, work);
+        *spectrum_out = (float *)spectrum;
+    }
+
+    free(frame);
+    free(work);
+    return ERR_OK;
+}
+
+/**
+ * Same framing as stft, keeping |X|^power per bin (power = 1 for magnitude, 2 for power spectrogram).
+ * Frame-major: frame f holds n_bins values starting at out[f * n_bins].
+ * @param power Exponent applied to the magnitude (> 0)
+ * @param magnitude_out Receives a malloc'ed array of n_frames_out * n_bins_out values (NULL when there is no frame)
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode stft_magnitude(const int16_t *samples, size_t N, size_t n_fft, size_t hop_length, int center,
+                         WindowType window, float power, float **magnitude_out, size_t *n_bins_out,
+                         size_t *n_frames_out)
+{
+    if (!magnitude_out || !n_bins_out || !n_frames_out || !(power > 0.0f))
+    {
+        set_error(ERR_INVALID_ARG, "stft_magnitude: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    const struct fft_plan *plan;
+    size_t n_frames;
+    float *frame;
+    struct fft_cpx *work;
+    ErrorCode rc = stft_setup("stft_magnitude: invalid argument", samples, N, n_fft, hop_length, center, window,
+                              &plan, &n_frames, &frame, &work);
+    if (rc != ERR_OK)
+        return rc;
+
+    const size_t n_bins = n_fft / 2 + 1;
+    struct fft_cpx *bins = malloc(n_bins * sizeof *bins);
+    float *mag = n_frames > 0 && n_frames <= SIZE_MAX / sizeof *mag / n_bins ? malloc(n_frames * n_bins * sizeof *mag)
+                                                                              : NULL;
+    if (!bins || (n_frames > 0 && !mag))
+    {
+        free(bins);
+        free(mag);
+        free(frame);
+        free(work);
+        set_error(ERR_OUT_OF_MEMORY, "stft_magnitude: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    const size_t pad = center ? n_fft / 2 : 0;
+    for (size_t f = 0; f < n_frames; ++f)
+        stft_power_row(plan, samples, N, hop_length, pad, f, power, mag + f * n_bins, frame, bins, work);
+
+    free(bins);
+    free(frame);
+    free(work);
+    *magnitude_out = mag;
+    *n_bins_out = n_bins;
+    *n_frames_out = n_frames;
+    return ERR_OK;
+}
+
+/**
+ * Inverse STFT by weighted overlap-add, like librosa.istft: frames are windowed again and divided by the
+ * sum of squared windows wherever it is not negligible. Output samples are floats (full scale = 1).
+ * @param spectrum Frame-major complex spectrum as produced by stft (n_frames * (n_fft / 2 + 1) pairs)
+ * @param n_fft FFT size used by stft
+ * @param n_frames Number of frames
+ * @param hop_length Hop used by stft
+ * @param center Same value as for stft: the n_fft / 2 padding is trimmed on both sides
+ * @param window Same window as for stft
+ * @param length Number of samples to produce (0 = every sample covered by the frames)
+ * @param signal_out Receives a malloc'ed array of n_out values
+ * @param n_out Receives the number of samples
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode istft(const float *spectrum, size_t n_fft, size_t n_frames, size_t hop_length, int center, WindowType window,
+                size_t length, float **signal_out, size_t *n_out)
+{
+    if ((!spectrum && n_frames > 0) || !signal_out || !n_out || n_fft == 0 || hop_length == 0 ||
+        (window != WINDOW_HANN && window != WINDOW_HAMMING && window != WINDOW_RECTANGULAR))
+    {
+        set_error(ERR_INVALID_ARG, "istft: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    const size_t n_bins = n_fft / 2 + 1;
+    const size_t pad = center ? n_fft / 2 : 0;
+    const size_t total = n_frames > 0 ? n_fft + hop_length * (n_frames - 1) : 0;
+    size_t n = length ? length : (total > 2 * pad ? total - 2 * pad : 0);
+
+    const struct fft_plan *plan = fft_plan_get(n_fft, window);
+    float *y = calloc(total > 0 ? total : 1, sizeof *y);
+    float *wss = calloc(total > 0 ? total : 1, sizeof *wss);
+    float *frame = malloc(n_fft * sizeof *frame);
+    float *out = calloc(n > 0 ? n : 1, sizeof *out);
+    struct fft_cpx *work = plan ? malloc(fft_work_size(plan) * sizeof *work) : NULL;
+    if (!y || !wss || !frame || !out || !work)
+    {
+        free(y);
+        free(wss);
+        free(frame);
+        free(out);
+        free(work);
+        set_error(ERR_OUT_OF_MEMORY, "istft: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    for (size_t f = 0; f < n_frames; ++f)
+    {
+        irfft_exec(plan, (const struct fft_cpx *)spectrum + f * n_bins, frame, work);
+        float *dst = y + f * hop_length;
+        float *norm = wss + f * hop_length;
+        for (size_t i = 0; i < n_fft; ++i)
+        {
+            dst[i] += frame[i] * plan->win[i];
+            norm[i] += plan->win[i] * plan->win[i];
+        }
+    }
+
+    // Même seuil que librosa : tiny(float32)
+    for (size_t i = 0; i < n && i + pad < total; ++i)
+        out[i] = wss[i + pad] > FLT_MIN ? y[i + pad] / wss[i + pad] : y[i + pad];
+
+    free(y);
+    free(wss);
+    free(frame);
+    free(work);
+    *signal_out = out;
+    *n_out = n;
+    return ERR_OK;
+}
+
+// ########################################## MEL ##########################################
+
+// Mel filterbank stored sparsely: filter i only covers bins [start[i], end[i]), its weights are packed
+// from weights[offset[i]]. The orthonormal DCT-II used by mfcc is built along with it.
+struct mel_bank {
+    uint32_t sample_rate;
+    size_t n_fft;
+    size_t n_mels;
+    float fmin;
+    float fmax;
+    size_t *start;
+    size_t *end;
+    size_t *offset;
+    float *weights;
+    float *dct;               // n_mels x n_mels, row k gives coefficient k
+    struct mel_bank *next;
+};
+
+// Slaney mel scale (librosa, htk=False): linear below 1 kHz, logarithmic above
+static double hz_to_mel(double hz)
+{
+    const double f_sp = 200.0 / 3.0, min_log_hz = 1000.0, min_log_mel = min_log_hz / f_sp;
+    const double logstep = log(6.4) / 27.0;
+    return hz >= min_log_hz ? min_log_mel + log(hz / min_log_hz) / logstep : hz / f_sp;
+}
+
+static double mel_to_hz(double mel)
+{
+    const double f_sp = 200.0 / 3.0, min_log_hz = 1000.0, min_log_mel = min_log_hz / f_sp;
+    const double logstep = log(6.4) / 27.0;
+    return mel >= min_log_mel ? min_log_hz * exp(logstep * (mel - min_log_mel)) : f_sp * mel;
+}
+
+// Frees one filterbank and returns the next one of the cache list
+static struct mel_bank *mel_bank_free(struct mel_bank *bank)
+{
+    if (!bank)
+        return NULL;
+    struct mel_bank *next = bank->next;
+    free(bank->start);
+    free(bank->end);
+    free(bank->offset);
+    free(bank->weights);
+    free(bank->dct);
+    free(bank);
+    return next;
+}
+
+// Same weights as librosa.filters.mel(norm="slaney"), rounded to float32 at the same steps
+static struct mel_bank *mel_bank_new(uint32_t sample_rate, size_t n_fft, size_t n_mels, float fmin, float fmax)
+{
+    const size_t n_bins = n_fft / 2 + 1;
+    struct mel_bank *bank = calloc(1, sizeof *bank);
+    double *edges = malloc((n_mels + 2) * sizeof *edges);
+    if (!bank || !edges)
+        goto fail;
+
+    bank->sample_rate = sample_rate;
+    bank->n_fft = n_fft;
+    bank->n_mels = n_mels;
+    bank->fmin = fmin;
+    bank->fmax = fmax;
+    bank->start = malloc(n_mels * sizeof *bank->start);
+    bank->end = malloc(n_mels * sizeof *bank->end);
+    bank->offset = malloc(n_mels * sizeof *bank->offset);
+    bank->dct = malloc(n_mels * n_mels * sizeof *bank->dct);
+    if (!bank->start || !bank->end || !bank->offset || !bank->dct)
+        goto fail;
+
+    // n_mels + 2 bords équidistants en mel (np.linspace), convertis en Hz
+    const double min_mel = hz_to_mel(fmin), max_mel = hz_to_mel(fmax);
+    const double step = (max_mel - min_mel) / (double)(n_mels + 1);
+    for (size_t i = 0; i < n_mels + 2; ++i)
+        edges[i] = mel_to_hz(i == n_mels + 1 ? max_mel : min_mel + (double)i * step);
+
+    // Premier passage : étendue de chaque filtre, pour dimensionner le stockage creux
+    const double bin_hz = (double)sample_rate / (double)n_fft;
+    size_t total = 0;
+    for (size_t i = 0; i < n_mels; ++i)
+    {
+        size_t lo = n_bins, hi = 0;
+        for (size_t k = 0; k < n_bins; ++k)
+        {
+            double fk = (double)k * bin_hz;
+            if (fk > edges[i] && fk < edges[i + 2])
+            {
+                if (lo == n_bins)
+                    lo = k;
+                hi = k + 1;
+            }
+        }
+        bank->start[i] = lo < hi ? lo : 0;
+        bank->end[i] = lo < hi ? hi : 0;
+        bank->offset[i] = total;
+        total += bank->end[i] - bank->start[i];
+    }
+
+    bank->weights = malloc((total > 0 ? total : 1) * sizeof *bank->weights);
+    if (!bank->weights)
+        goto fail;
+
+    for (size_t i = 0; i < n_mels; ++i)
+    {
+        const double enorm = 2.0 / (edges[i + 2] - edges[i]);
+        for (size_t k = bank->start[i]; k < bank->end[i]; ++k)
+        {
+            double fk = (double)k * bin_hz;
+            double lower = (fk - edges[i]) / (edges[i + 1] - edges[i]);
+            double upper = (edges[i + 2] - fk) / (edges[i + 2] - edges[i + 1]);
+            double tri = lower < upper ? lower : upper;
+            float w = (float)(tri > 0.0 ? tri : 0.0);
+            bank->weights[bank->offset[i] + k - bank->start[i]] = (float)((double)w * enorm);
+        }
+    }
+
+    // DCT-II orthonormée (scipy.fft.dct(norm="ortho"))
+    for (size_t k = 0; k < n_mels; ++k)
+    {
+        double scale = k == 0 ? sqrt(1.0 / (double)n_mels) : sqrt(2.0 / (double)n_mels);
+        for (size_t n = 0; n < n_mels; ++n)
+            bank->dct[k * n_mels + n] = (float)(scale * cos(M_PI * (double)k * (2.0 * (double)n + 1.0) / (2.0 * (double)n_mels)));
+    }
+
+    free(edges);
+    return bank;
+
+fail:
+    free(edges);
+    mel_bank_free(bank);
+    return NULL;
+}
+
+static const struct mel_bank *mel_bank_get(uint32_t sample_rate, size_t n_fft, size_t n_mels, float fmin, float fmax)
+{
+    pthread_mutex_lock(&plan_cache_lock);
+    struct mel_bank *bank = mel_cache;
+    while (bank && (bank->sample_rate != sample_rate || bank->n_fft != n_fft || bank->n_mels != n_mels ||
+                    bank->fmin != fmin || bank->fmax != fmax))
+        bank = bank->next;
+    if (!bank)
+    {
+        bank = mel_bank_new(sample_rate, n_fft, n_mels, fmin, fmax);
+        if (bank)
+        {
+            bank->next = mel_cache;
+            mel_cache = bank;
+        }
+    }
+    pthread_mutex_unlock(&plan_cache_lock);
+    return bank;
+}
+
+/**
+ * Fills p with the defaults of librosa.feature.melspectrogram / mfcc: n_fft 2048, hop 512, centered
+ * Hann frames, power spectrum, 128 Slaney-normalized mel bands from 0 Hz to sample_rate / 2
+ */
+void mel_params_default(struct mel_params *p, uint32_t sample_rate)
+{
+    if (!p)
+        return;
+    p->sample_rate = sample_rate;
+    p->n_fft = 2048;
+    p->hop_length = 512;
+    p->center = 1;
+    p->window = WINDOW_HANN;
+    p->power = 2.0f;
+    p->n_mels = 128;
+    p->fmin = 0.0f;
+    p->fmax = 0.0f;
+}
+
+/**
+ * Dense copy of the mel filterbank used by mel_spectrogram (n_mels rows of n_fft / 2 + 1 weights),
+ * equal to librosa.filters.mel(sr=sample_rate, n_fft=n_fft, n_mels=n_mels, fmin=fmin, fmax=fmax)
+ * @param weights_out Receives a malloc'ed array of n_mels * (n_fft / 2 + 1) values
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode mel_filterbank(const struct mel_params *p, float **weights_out)
+{
+    float fmax = p && p->fmax > 0.0f ? p->fmax : (p ? (float)p->sample_rate / 2.0f : 0.0f);
+    if (!p || !weights_out || p->sample_rate == 0 || p->n_fft == 0 || p->n_mels == 0 || p->fmin < 0.0f ||
+        p->fmin >= fmax)
+    {
+        set_error(ERR_INVALID_ARG, "mel_filterbank: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    const size_t n_bins = p->n_fft / 2 + 1;
+    const struct mel_bank *bank = mel_bank_get(p->sample_rate, p->n_fft, p->n_mels, p->fmin, fmax);
+    float *dense = bank ? calloc(p->n_mels * n_bins, sizeof *dense) : NULL;
+    if (!dense)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "mel_filterbank: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    for (size_t i = 0; i < p->n_mels; ++i)
+        memcpy(dense + i * n_bins + bank->start[i], bank->weights + bank->offset[i],
+               (bank->end[i] - bank->start[i]) * sizeof *dense);
+    *weights_out = dense;
+    return ERR_OK;
+}
+
+// Computes the frame-major mel spectrogram shared by mel_spectrogram and mfcc
+static ErrorCode mel_frames(const char *name, const int16_t *samples, size_t N, const struct mel_params *p,
+                            const struct mel_bank **bank_out, float **mel_out, size_t *n_frames_out)
+{
+    float fmax = p && p->fmax > 0.0f ? p->fmax : (p ? (float)p->sample_rate / 2.0f : 0.0f);
+    if (!p || !mel_out || !n_frames_out || p->sample_rate == 0 || p->n_mels == 0 || !(p->power > 0.0f) ||
+        p->fmin < 0.0f || p->fmin >= fmax)
+    {
+        set_error(ERR_INVALID_ARG, name);
+        return ERR_INVALID_ARG;
+    }
+
+    const struct fft_plan *plan;
+    size_t n_frames;
+    float *frame;
+    struct fft_cpx *work;
+    ErrorCode rc = stft_setup(name, samples, N, p->n_fft, p->hop_length, p->center, p->window, &plan, &n_frames,
+                              &frame, &work);
+    if (rc != ERR_OK)
+        return rc;
+
+    const size_t n_bins = p->n_fft / 2 + 1;
+    const size_t n_mels = p->n_mels;
+    const struct mel_bank *bank = mel_bank_get(p->sample_rate, p->n_fft, n_mels, p->fmin, fmax);
+    struct fft_cpx *bins = malloc(n_bins * sizeof *bins);
+    float *row = malloc(n_bins * sizeof *row);
+    float *mel = n_frames > 0 && n_frames <= SIZE_MAX / sizeof *mel / n_mels ? malloc(n_frames * n_mels * sizeof *mel)
+                                                                              : NULL;
+    if (!bank || !bins || !row || (n_frames > 0 && !mel))
+    {
+        free(bins);
+        free(row);
+        free(mel);
+        free(frame);
+        free(work);
+        set_error(ERR_OUT_OF_MEMORY, "mel: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    const size_t pad = p->center ? p->n_fft / 2 : 0;
+    for (size_t f = 0; f < n_frames; ++f)
+    {
+        stft_power_row(plan, samples, N, p->hop_length, pad, f, p->power, row, frame, bins, work);
+        float *out = mel + f * n_mels;
+        // Produit creux : chaque filtre ne parcourt que ses bins non nuls
+        for (size_t i = 0; i < n_mels; ++i)
+        {
+            const float *w = bank->weights + bank->offset[i];
+            float acc = 0.0f;
+            for (size_t k = bank->start[i]; k < bank->end[i]; ++k)
+                acc += w[k - bank->start[i]] * row[k];
+            out[i] = acc;
+        }
+    }
+
+    free(bins);
+    free(row);
+    free(frame);
+    free(work);
+    *bank_out = bank;
+    *mel_out = mel;
+    *n_frames_out = n_frames;
+    return ERR_OK;
+}
+
+/**
+ * Computes the mel spectrogram of a signal, like librosa.feature.melspectrogram on the float signal
+ * (samples / 32768) with the parameters of p (see mel_params_default).
+ * Frame-major: frame f holds n_mels values starting at mel_out[f * n_mels].
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param p Framing, window and filterbank parameters (fmax <= 0 means sample_rate / 2)
+ * @param mel_out Receives a malloc'ed array of n_frames_out * p->n_mels values (NULL when there is no frame)
+ * @param n_frames_out Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode mel_spectrogram(const int16_t *samples, size_t N, const struct mel_params *p, float **mel_out,
+                          size_t *n_frames_out)
+{
+    const struct mel_bank *bank;
+    return mel_frames("mel_spectrogram: invalid argument", samples, N, p, &bank, mel_out, n_frames_out);
+}
+
+// librosa.power_to_db(S, ref=1.0, amin=1e-10, top_db=80.0) in place, over the whole spectrogram
+static void power_to_db(float *values, size_t n)
+{
+    // Le plancher top_db dépend du maximum de tout le signal
+    float peak = -INFINITY;
+    for (size_t i = 0; i < n; ++i)
+    {
+        values[i] = 10.0f * log10f(values[i] > 1e-10f ? values[i] : 1e-10f);
+        if (values[i] > peak)
+            peak = values[i];
+    }
+    const float floor_db = peak - 80.0f;
+    for (size_t i = 0; i < n; ++i)
+        if (values[i] < floor_db)
+            values[i] = floor_db;
+}
+
+/**
+ * Computes MFCCs like librosa.feature.mfcc (dct_type 2, norm "ortho", no lifter): the mel spectrogram
+ * is converted to dB (power_to_db with ref 1, amin 1e-10, top_db 80 over the whole signal) and projected
+ * on the first n_mfcc rows of a precomputed DCT-II.
+ * Frame-major: frame f holds n_mfcc values starting at mfcc_out[f * n_mfcc].
+ * @param p Mel parameters (see mel_params_default)
+ * @param n_mfcc Number of coefficients (1 .. p->n_mels, librosa default 20)
+ * @param mfcc_out Receives a malloc'ed array of n_frames_out * n_mfcc values (NULL when there is no frame)
+ * @param n_frames_out Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode mfcc(const int16_t *samples, size_t N, const struct mel_params *p, size_t n_mfcc, float **mfcc_out,
+               size_t *n_frames_out)
+{
+    if (!p || n_mfcc == 0 || n_mfcc > p->n_mels || !mfcc_out)
+    {
+        set_error(ERR_INVALID_ARG, "mfcc: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    const struct mel_bank *bank;
+    float *mel;
+    size_t n_frames;
+    ErrorCode rc = mel_frames("mfcc: invalid argument", samples, N, p, &bank, &mel, &n_frames);
+    if (rc != ERR_OK)
+        return rc;
+
+    *n_frames_out = n_frames;
+    *mfcc_out = NULL;
+    if (n_frames == 0)
+        return ERR_OK;
+
+    float *out = malloc(n_frames * n_mfcc * sizeof *out);
+    if (!out)
+    {
+        free(mel);
+        set_error(ERR_OUT_OF_MEMORY, "mfcc: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    const size_t n_mels = p->n_mels;
+    power_to_db(mel, n_frames * n_mels);
+
+    for (size_t f = 0; f < n_frames; ++f)
+    {
+        const float *db = mel + f * n_mels;
+        for (size_t k = 0; k < n_mfcc; ++k)
+        {
+            const float *basis = bank->dct + k * n_mels;
+            float acc = 0.0f;
+            for (size_t n = 0; n < n_mels; ++n)
+                acc += basis[n] * db[n];
+            out[f * n_mfcc + k] = acc;
+        }
+    }
+
+    free(mel);
+    *mfcc_out = out;
+    return ERR_OK;
+}
+
+// ########################################## SPECTRAL FEATURES ##########################################
+
+// Destinations of spectral_frame, a NULL array skips its feature
+struct spectral_outputs {
+    float *centroid;
+    float *bandwidth;
+    float *rolloff;
+    float *flatness;
+    float *flux;
+};
+
+/**
+ * Computes every requested feature of frame f from its magnitude spectrum (librosa formulas, see
+ * spectral_features). prev is the previous frame's spectrum, or NULL for the first frame.
+ */
+static void spectral_frame(const float *mag, const float *prev, size_t n_bins, double bin_hz, float roll_percent,
+                           const struct spectral_outputs *out, size_t f)
+{
+    // Premier passage : moments, énergie totale, moyennes de la puissance et flux
+    double total = 0.0, weighted = 0.0, log_sum = 0.0, power_sum = 0.0, diff_sq = 0.0;
+    for (size_t k = 0; k < n_bins; ++k)
+    {
+        double s = mag[k];
+        total += s;
+        weighted += s * (double)k;
+        if (out->flatness)
+        {
+            double p = s * s > 1e-10 ? s * s : 1e-10;
+            log_sum += log(p);
+            power_sum += p;
+        }
+        if (out->flux && prev)
+        {
+            double d = s - prev[k];
+            diff_sq += d * d;
+        }
+    }
+
+    // Trame silencieuse : librosa.util.normalize laisse S inchangé, le centroïde vaut 0
+    const double norm = total >= FLT_MIN ? total : 1.0;
+    const double centroid = bin_hz * weighted / norm;
+    if (out->centroid)
+        out->centroid[f] = (float)centroid;
+    if (out->flatness)
+        out->flatness[f] = (float)(exp(log_sum / (double)n_bins) / (power_sum / (double)n_bins));
+    if (out->flux)
+        out->flux[f] = (float)sqrt(diff_sq);
+
+    // Second passage, seulement si demandé : écart au centroïde et seuil d'énergie cumulée
+    if (out->bandwidth)
+    {
+        double spread = 0.0;
+        for (size_t k = 0; k < n_bins; ++k)
+        {
+            double dev = (double)k * bin_hz - centroid;
+            spread += mag[k] * dev * dev;
+        }
+        out->bandwidth[f] = (float)sqrt(spread / norm);
+    }
+    if (out->rolloff)
+    {
+        const double threshold = (double)roll_percent * total;
+        double cumulative = 0.0;
+        size_t k = 0;
+        while (k + 1 < n_bins)
+        {
+            cumulative += mag[k];
+            if (cumulative >= threshold)
+                break;
+            ++k;
+        }
+        out->rolloff[f] = (float)((double)k * bin_hz);
+    }
+}
+
+// Validates the output pointers and allocates one array per requested feature
+static ErrorCode spectral_alloc(const char *name, size_t n_frames, float **centroid_out, float **bandwidth_out,
+                                float **rolloff_out, float **flatness_out, float **flux_out,
+                                struct spectral_outputs *out)
+{
+    float **dst[5] = {centroid_out, bandwidth_out, rolloff_out, flatness_out, flux_out};
+    float **arrays[5] = {&out->centroid, &out->bandwidth, &out->rolloff, &out->flatness, &out->flux};
+    int ok = 1;
+    for (size_t i = 0; i < 5; ++i)
+    {
+        *arrays[i] = NULL;
+        if (dst[i] && n_frames > 0)
+        {
+            *arrays[i] = malloc(n_frames * sizeof(float));
+            ok = ok && *arrays[i];
+        }
+    }
+    if (!ok)
+    {
+        for (size_t i = 0; i < 5; ++i)
+            free(*arrays[i]);
+        set_error(ERR_OUT_OF_MEMORY, name);
+        return ERR_OUT_OF_MEMORY;
+    }
+    return ERR_OK;
+}
+
+static void spectral_publish(const struct spectral_outputs *out, float **centroid_out, float **bandwidth_out,
+                             float **rolloff_out, float **flatness_out, float **flux_out)
+{
+    if (centroid_out)
+        *centroid_out = out->centroid;
+    if (bandwidth_out)
+        *bandwidth_out = out->bandwidth;
+    if (rolloff_out)
+        *rolloff_out = out->rolloff;
+    if (flatness_out)
+        *flatness_out = out->flatness;
+    if (flux_out)
+        *flux_out = out->flux;
+}
+
+/**
+ * Computes spectral features from an existing magnitude spectrogram (stft_magnitude with power 1),
+ * without any FFT. The frequency of bin k is k * sample_rate / n_fft with n_fft = 2 * (n_bins - 1),
+ * as librosa does when given S. See spectral_features for the definitions.
+ * @param magnitude Frame-major magnitudes: frame f holds n_bins values starting at magnitude[f * n_bins]
+ * @param n_bins Number of bins per frame (n_fft / 2 + 1, >= 2)
+ * @param n_frames Number of frames
+ * @param sample_rate Sampling rate in Hz
+ * @param roll_percent Energy fraction of the rolloff, in (0, 1] (librosa default 0.85)
+ * @param centroid_out, bandwidth_out, rolloff_out, flatness_out, flux_out Receive malloc'ed arrays of
+ *        n_frames_out values (NULL when there is no frame), a NULL pointer skips its feature
+ * @param n_frames_out Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode spectral_features_from_magnitude(const float *magnitude, size_t n_bins, size_t n_frames,
+                                           uint32_t sample_rate, float roll_percent, float **centroid_out,
+                                           float **bandwidth_out, float **rolloff_out, float **flatness_out,
+                                           float **flux_out, size_t *n_frames_out)
+{
+    if ((!magnitude && n_frames > 0) || n_bins < 2 || sample_rate == 0 || !(roll_percent > 0.0f) ||
+        roll_percent > 1.0f || !n_frames_out)
+    {
+        set_error(ERR_INVALID_ARG, "spectral_features_from_magnitude: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    struct spectral_outputs out;
+    ErrorCode rc = spectral_alloc("spectral_features_from_magnitude: allocation failed", n_frames, centroid_out,
+                                  bandwidth_out, rolloff_out, flatness_out, flux_out, &out);
+    if (rc != ERR_OK)
+        return rc;
+
+    const double bin_hz = (double)sample_rate / (double)(2 * (n_bins - 1));
+    for (size_t f = 0; f < n_frames; ++f)
+        spectral_frame(magnitude + f * n_bins, f > 0 ? magnitude + (f - 1) * n_bins : NULL, n_bins, bin_hz,
+                       roll_percent, &out, f);
+
+    spectral_publish(&out, centroid_out, bandwidth_out, rolloff_out, flatness_out, flux_out);
+    *n_frames_out = n_frames;
+    return ERR_OK;
+}
+
+/**
+ * Computes spectral features of a signal from a single STFT: each frame's magnitude spectrum is
+ * computed once and shared by every requested feature. Definitions follow librosa on the magnitude
+ * spectrogram S (window, framing and scaling as stft):
+ * - centroid: sum(freq * S) / sum(S) (spectral_centroid)
+ * - bandwidth: sqrt(sum(S * (freq - centroid)^2) / sum(S)) (spectral_bandwidth, p = 2)
+ * - rolloff: lowest bin frequency where the cumulated S reaches roll_percent of sum(S) (spectral_rolloff)
+ * - flatness: geometric / arithmetic mean of max(1e-10, S^2) (spectral_flatness)
+ * - flux: Euclidean distance between S and the previous frame's S, 0 for the first frame
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param sample_rate Sampling rate in Hz
+ * @param n_fft FFT size and frame length (n_fft >= 2)
+ * @param hop_length Number of samples between two frame starts (> 0)
+ * @param center Non-zero to pad n_fft / 2 zeros on both sides
+ * @param window WINDOW_HANN, WINDOW_HAMMING or WINDOW_RECTANGULAR
+ * @param roll_percent Energy fraction of the rolloff, in (0, 1] (librosa default 0.85)
+ * @param centroid_out, bandwidth_out, rolloff_out, flatness_out, flux_out Receive malloc'ed arrays of
+ *        n_frames_out values (NULL when there is no frame), a NULL pointer skips its feature
+ * @param n_frames_out Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode spectral_features(const int16_t *samples, size_t N, uint32_t sample_rate, size_t n_fft, size_t hop_length,
+                            int center, WindowType window, float roll_percent, float **centroid_out,
+                            float **bandwidth_out, float **rolloff_out, float **flatness_out, float **flux_out,
+                            size_t *n_frames_out)
+{
+    if (n_fft < 2 || sample_rate == 0 || !(roll_percent > 0.0f) || roll_percent > 1.0f || !n_frames_out)
+    {
+        set_error(ERR_INVALID_ARG, "spectral_features: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    const struct fft_plan *plan;
+    size_t n_frames;
+    float *frame;
+    struct fft_cpx *work;
+    ErrorCode rc = stft_setup("spectral_features: invalid argument", samples, N, n_fft, hop_length, center, window,
+                              &plan, &n_frames, &frame, &work);
+    if (rc != ERR_OK)
+        return rc;
+
+    const size_t n_bins = n_fft / 2 + 1;
+    struct fft_cpx *bins = malloc(n_bins * sizeof *bins);
+    float *rows = malloc(2 * n_bins * sizeof *rows);
+    struct spectral_outputs out;
+    rc = bins && rows ? spectral_alloc("spectral_features: allocation failed", n_frames, centroid_out, bandwidth_out,
+                                       rolloff_out, flatness_out, flux_out, &out)
+                      : ERR_OUT_OF_MEMORY;
+    if (rc != ERR_OK)
+    {
+        free(bins);
+        free(rows);
+        free(frame);
+        free(work);
+        set_error(ERR_OUT_OF_MEMORY, "spectral_features: allocation failed");
+        return rc;
+    }
+
+    // Deux spectres en alternance : la trame courante et la précédente pour le flux
+    const size_t pad = center ? n_fft / 2 : 0;
+    const double bin_hz = (double)sample_rate / (double)n_fft;
+    for (size_t f = 0; f < n_frames; ++f)
+    {
+        float *row = rows + (f % 2) * n_bins;
+        stft_power_row(plan, samples, N, hop_length, pad, f, 1.0f, row, frame, bins, work);
+        spectral_frame(row, f > 0 ? rows + ((f + 1) % 2) * n_bins : NULL, n_bins, bin_hz, roll_percent, &out, f);
+    }
+
+    free(bins);
+    free(rows);
+    free(frame);
+    free(work);
+    spectral_publish(&out, centroid_out, bandwidth_out, rolloff_out, flatness_out, flux_out);
+    *n_frames_out = n_frames;
+    return ERR_OK;
+}
+
+// ########################################## PITCH ##########################################
+
+/**
+ * Cumulative mean normalized difference of one frame y (frame_length samples, win_length = frame_length / 2),
+ * as librosa's yin: the difference d(tau) = sum_{j=1..W} (y[j] - y[j + tau])^2 is expanded into energies and
+ * the autocorrelation sum_{j=1..W} y[j] * y[j + tau], obtained through FFTs of y and of its reversed window.
+ * Writes cmnd[tau - min_period] for tau in [min_period, max_period].
+ */
+static void yin_cmnd(const struct fft_plan *plan, const float *y, size_t win_length, size_t min_period,
+                     size_t max_period, float *cmnd, float *buf, double *energy, struct fft_cpx *a, struct fft_cpx *b,
+                     struct fft_cpx *work)
+{
+    const size_t n = plan->n, n_bins = n / 2 + 1;
+
+    // Corrélation par convolution avec y[W], y[W - 1], ..., y[1]
+    rfft_exec(plan, y, a, work);
+    for (size_t m = 0; m < n; ++m)
+        buf[m] = m < win_length ? y[win_length - m] : 0.0f;
+    rfft_exec(plan, buf, b, work);
+    for (size_t k = 0; k < n_bins; ++k)
+        a[k] = cpx_mul(a[k], b[k]);
+    irfft_exec(plan, a, buf, work);
+
+    // energy[tau] = somme de y^2 sur [tau + 1, tau + W]
+    double cumulative = 0.0, window_start = 0.0;
+    for (size_t j = 0; j <= win_length; ++j)
+        cumulative += j > 0 ? (double)y[j] * y[j] : 0.0;
+    for (size_t tau = 0; tau <= max_period; ++tau)
+    {
+        if (tau > 0)
+        {
+            cumulative += (double)y[tau + win_length] * y[tau + win_length];
+            window_start += (double)y[tau] * y[tau];
+        }
+        double e = cumulative - window_start;
+        energy[tau] = fabs(e) < 1e-6 ? 0.0 : e;
+    }
+
+    double running = 0.0;
+    for (size_t tau = 1; tau <= max_period; ++tau)
+    {
+        double acf = buf[win_length + tau];
+        if (fabs(acf) < 1e-6)
+            acf = 0.0;
+        double d = energy[0] + energy[tau] - 2.0 * acf;
+        running += d;
+        if (tau >= min_period)
+            cmnd[tau - min_period] = (float)(d / (running / (double)tau + FLT_MIN));
+    }
+}
+
+// Period (in samples, fractional) picked from the normalized difference, librosa's trough rule
+static double yin_period(const float *cmnd, size_t n, size_t min_period, float trough_threshold)
+{
+    size_t best = 0, pick = n;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (cmnd[i] < cmnd[best])
+            best = i;
+        // Premier creux local sous le seuil
+        int trough = i == 0 ? n > 1 && cmnd[0] < cmnd[1]
+                            : cmnd[i] < cmnd[i - 1] && (i + 1 == n || cmnd[i] <= cmnd[i + 1]);
+        if (pick == n && trough && cmnd[i] < trough_threshold)
+            pick = i;
+    }
+    if (pick == n)
+        pick = best;
+
+    double shift = 0.0;
+    if (pick > 0 && pick + 1 < n)
+    {
+        double pa = (double)cmnd[pick + 1] + cmnd[pick - 1] - 2.0 * cmnd[pick];
+        double pb = ((double)cmnd[pick + 1] - cmnd[pick - 1]) / 2.0;
+        if (fabs(pb) < fabs(pa))
+            shift = -pb / pa;
+    }
+    return (double)(min_period + pick) + shift;
+}
+
+/**
+ * Estimates the fundamental frequency of each frame with YIN, like librosa.yin(y / 32768, fmin=fmin,
+ * fmax=fmax, sr=sample_rate, frame_length=frame_length, hop_length=hop_length, center=center,
+ * trough_threshold=trough_threshold) with its default win_length = frame_length / 2 and zero padding.
+ * Frames follow the frame/hop/center semantics of zero_crossing_rate. The difference function is
+ * computed through FFT autocorrelation, O(frame_length log frame_length) per frame. Every frame gets a
+ * frequency (there is no voicing decision, pYIN is not implemented).
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param sample_rate Sampling rate in Hz
+ * @param frame_length Number of samples per frame (librosa default 2048)
+ * @param hop_length Number of samples between two frame starts (> 0, librosa default frame_length / 4)
+ * @param center Non-zero to pad frame_length / 2 zeros on both sides
+ * @param fmin Lowest frequency searched in Hz (> 0)
+ * @param fmax Highest frequency searched in Hz (fmin < fmax <= sample_rate)
+ * @param trough_threshold Absolute threshold of the first trough (librosa default 0.1)
+ * @param f0_out Receives a malloc'ed array of n_frames_out frequencies in Hz (NULL when there is no frame)
+ * @param n_frames_out Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode yin(const int16_t *samples, size_t N, uint32_t sample_rate, size_t frame_length, size_t hop_length,
+              int center, float fmin, float fmax, float trough_threshold, float **f0_out, size_t *n_frames_out)
+{
+    if (!f0_out || !n_frames_out || sample_rate == 0 || frame_length < 4 || !(fmin > 0.0f) || !(fmax > fmin) ||
+        fmax > (float)sample_rate)
+    {
+        set_error(ERR_INVALID_ARG, "yin: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    const size_t win_length = frame_length / 2;
+    const size_t min_period = (size_t)floor((double)sample_rate / fmax);
+    size_t max_period = (size_t)ceil((double)sample_rate / fmin);
+    if (max_period > frame_length - win_length - 1)
+        max_period = frame_length - win_length - 1;
+    if (min_period < 1 || max_period <= min_period)
+    {
+        set_error(ERR_INVALID_ARG, "yin: frame_length too short for fmin/fmax");
+        return ERR_INVALID_ARG;
+    }
+
+    const struct fft_plan *plan;
+    size_t n_frames;
+    float *frame;
+    struct fft_cpx *work;
+    ErrorCode rc = stft_setup("yin: invalid argument", samples, N, frame_length, hop_length, center,
+                              WINDOW_RECTANGULAR, &plan, &n_frames, &frame, &work);
+    if (rc != ERR_OK)
+        return rc;
+
+    const size_t n_bins = frame_length / 2 + 1, n_periods = max_period - min_period + 1;
+    float *buf = malloc(frame_length * sizeof *buf);
+    float *cmnd = malloc(n_periods * sizeof *cmnd);
+    double *energy = malloc((max_period + 1) * sizeof *energy);
+    struct fft_cpx *a = malloc(2 * n_bins * sizeof *a);
+    float *f0 = n_frames > 0 ? malloc(n_frames * sizeof *f0) : NULL;
+    if (!buf || !cmnd || !energy || !a || (n_frames > 0 && !f0))
+    {
+        free(buf);
+        free(cmnd);
+        free(energy);
+        free(a);
+        free(f0);
+        free(frame);
+        free(work);
+        set_error(ERR_OUT_OF_MEMORY, "yin: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    const size_t pad = center ? frame_length / 2 : 0;
+    for (size_t f = 0; f < n_frames; ++f)
+    {
+        stft_gather(plan, samples, N, hop_length, pad, f, frame);
+        yin_cmnd(plan, frame, win_length, min_period, max_period, cmnd, buf, energy, a, a + n_bins, work);
+        f0[f] = (float)((double)sample_rate / yin_period(cmnd, n_periods, min_period, trough_threshold));
+    }
+
+    free(buf);
+    free(cmnd);
+    free(energy);
+    free(a);
+    free(frame);
+    free(work);
+    *f0_out = f0;
+    *n_frames_out = n_frames;
+    return ERR_OK;
+}
+
+// ########################################## LOUDNESS ##########################################
+
+// Oversampling interpolator of the true-peak meter: 49-tap Hann-windowed sinc split into phases,
+// each phase padded to TRUE_PEAK_TAPS coefficients for the dot_f32 kernel
+#define TRUE_PEAK_FIR 49
+#define TRUE_PEAK_TAPS 32
+// Frames processed per channel between two segment checks
+#define LOUDNESS_CHUNK 1024
+// Gating blocks are made of 100 ms segments: 4 for momentary (400 ms), 30 for short-term (3 s)
+#define LOUDNESS_MOMENTARY_SEGMENTS 4
+#define LOUDNESS_SHORT_TERM_SEGMENTS 30
+
+struct loudness_channel {
+    double weight;               // BS.1770 channel weight G (0 for the LFE)
+    double state[4];             // two K-weighting biquads, transposed direct form II
+    double energy;               // sum of the squared K-weighted samples of the current segment
+    double true_peak;
+    double sample_peak;
+    float history[TRUE_PEAK_TAPS - 1];
+};
+
+// Growable list of block energies kept for the gated measurements
+struct energy_list {
+    double *values;
+    size_t count;
+    size_t capacity;
+};
+
+struct loudness_meter {
+    uint16_t channels;
+    uint32_t sample_rate;
+    double shelf[5];             // b0, b1, b2, a1, a2 of the high-shelf pre-filter
+    double highpass[5];          // same for the RLB high-pass
+    size_t oversampling;         // true-peak interpolation factor (1 when no interpolation)
+    float *phases;               // oversampling x TRUE_PEAK_TAPS coefficients, oldest sample first
+    float *scratch;              // TRUE_PEAK_TAPS - 1 + LOUDNESS_CHUNK samples of one channel
+    size_t segment_frames;       // frames per 100 ms segment
+    size_t segment_fill;
+    double segments[LOUDNESS_SHORT_TERM_SEGMENTS]; // weighted energies of the last segments (ring)
+    uint64_t n_segments;
+    double momentary_max;
+    double short_term_max;
+    struct energy_list blocks;   // 400 ms energies every 100 ms, above the absolute gate
+    struct energy_list short_terms; // 3 s energies every second, above the absolute gate
+    struct loudness_channel *state;
+};
+
+// -70 LUFS, as an energy
+#define LOUDNESS_ABSOLUTE_GATE 1.1724653045822963e-7
+
+static double energy_to_loudness(double energy)
+{
+    return energy > 0.0 ? -0.691 + 10.0 * log10(energy) : -HUGE_VAL;
+}
+
+static int energy_list_push(struct energy_list *list, double value)
+{
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity ? 2 * list->capacity : 256;
+        double *values = realloc(list->values, capacity * sizeof *values);
+        if (!values)
+            return 0;
+        list->values = values;
+        list->capacity = capacity;
+    }
+    list->values[list->count++] = value;
+    return 1;
+}
+
+// K-weighting coefficients for any sample rate (pre-filter and RLB filter of BS.1770, as libebur128)
+static void k_weighting(uint32_t sample_rate, double shelf[5], double highpass[5])
+{
+    double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / (double)sample_rate);
+    double vh = pow(10.0, gain / 20.0), vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    shelf[0] = (vh + vb * k / q + k * k) / a0;
+    shelf[1] = 2.0 * (k * k - vh) / a0;
+    shelf[2] = (vh - vb * k / q + k * k) / a0;
+    shelf[3] = 2.0 * (k * k - 1.0) / a0;
+    shelf[4] = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / (double)sample_rate);
+    a0 = 1.0 + k / q + k * k;
+    highpass[0] = 1.0;
+    highpass[1] = -2.0;
+    highpass[2] = 1.0;
+    highpass[3] = 2.0 * (k * k - 1.0) / a0;
+    highpass[4] = (1.0 - k / q + k * k) / a0;
+}
+
+// BS.1770 weights with the default layouts of libebur128 (L R C LFE Ls Rs, L R Ls Rs for 4, L R C Ls Rs for 5)
+static double channel_weight(uint16_t channels, uint16_t c)
+{
+    if (channels == 4)
+        return c >= 2 ? 1.41 : 1.0;
+    if (channels == 5)
+        return c >= 3 ? 1.41 : 1.0;
+    if (c < 3)
+        return 1.0;
+    return c == 4 || c == 5 ? 1.41 : 0.0;
+}
+
+/**
+ * Creates a loudness meter (ITU-R BS.1770-4 / EBU R128): K-weighting, momentary (400 ms), short-term (3 s)
+ * and gated integrated loudness, loudness range (EBU Tech 3342) and true peak. Samples are pushed in
+ * interleaved int16 buffers, as produced by retrieve_wav_data, and every statistic is updated in the same pass.
+ * @param channels Number of interleaved channels (weights follow the L R C LFE Ls Rs order)
+ * @param sample_rate Sampling rate in Hz (>= 8000)
+ * @param out_meter Receives the new meter, to release with loudness_meter_free
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode loudness_meter_create(uint16_t channels, uint32_t sample_rate, struct loudness_meter **out_meter)
+{
+    if (!out_meter || channels == 0 || sample_rate < 8000)
+    {
+        set_error(ERR_INVALID_ARG, "loudness_meter_create: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    struct loudness_meter *m = calloc(1, sizeof *m);
+    // Suréchantillonnage x4 sous 96 kHz, x2 sous 192 kHz (BS.1770-4 annexe 2)
+    size_t oversampling = sample_rate < 96000 ? 4 : sample_rate < 192000 ? 2 : 1;
+    if (m)
+    {
+        m->state = calloc(channels, sizeof *m->state);
+        m->phases = calloc(oversampling * TRUE_PEAK_TAPS, sizeof *m->phases);
+        m->scratch = malloc((TRUE_PEAK_TAPS - 1 + LOUDNESS_CHUNK) * sizeof *m->scratch);
+    }
+    if (!m || !m->state || !m->phases || !m->scratch)
+    {
+        loudness_meter_free(m);
+        set_error(ERR_OUT_OF_MEMORY, "loudness_meter_create: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    m->channels = channels;
+    m->sample_rate = sample_rate;
+    m->oversampling = oversampling;
+    m->segment_frames = (sample_rate + 5) / 10;
+    m->momentary_max = -HUGE_VAL;
+    m->short_term_max = -HUGE_VAL;
+    k_weighting(sample_rate, m->shelf, m->highpass);
+    for (uint16_t c = 0; c < channels; ++c)
+        m->state[c].weight = channel_weight(channels, c);
+
+    // Le coefficient j agit sur la phase j % L avec un retard de j / L échantillons
+    if (oversampling > 1)
+        for (size_t j = 0; j < TRUE_PEAK_FIR; ++j)
+        {
+            double t = (double)j - (TRUE_PEAK_FIR - 1) / 2.0;
+            double c = fabs(t) > 1e-6 ? sin(t * M_PI / (double)oversampling) / (t * M_PI / (double)oversampling) : 1.0;
+            c *= 0.5 * (1.0 - cos(2.0 * M_PI * (double)j / (TRUE_PEAK_FIR - 1)));
+            m->phases[(j % oversampling) * TRUE_PEAK_TAPS + TRUE_PEAK_TAPS - 1 - j / oversampling] = (float)c;
+        }
+
+    *out_meter = m;
+    return ERR_OK;
+}
+
+void loudness_meter_free(struct loudness_meter *m)
+{
+    if (!m)
+        return;
+    free(m->state);
+    free(m->phases);
+    free(m->scratch);
+    free(m->blocks.values);
+    free(m->short_terms.values);
+    free(m);
+}
+
+// Mean energy of the last n segments (missing segments count as silence)
+static double segments_energy(const struct loudness_meter *m, size_t n)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < n && i < m->n_segments; ++i)
+        sum += m->segments[(m->n_segments - 1 - i) % LOUDNESS_SHORT_TERM_SEGMENTS];
+    return sum / (double)n;
+}
+
+// Closes the current 100 ms segment and updates the gating blocks
+static int loudness_segment_done(struct loudness_meter *m)
+{
+    double weighted = 0.0;
+    for (uint16_t c = 0; c < m->channels; ++c)
+    {
+        weighted += m->state[c].weight * m->state[c].energy;
+        m->state[c].energy = 0.0;
+    }
+    m->segments[m->n_segments % LOUDNESS_SHORT_TERM_SEGMENTS] = weighted / (double)m->segment_frames;
+    m->n_segments++;
+    m->segment_fill = 0;
+
+    double momentary = segments_energy(m, LOUDNESS_MOMENTARY_SEGMENTS);
+    double short_term = segments_energy(m, LOUDNESS_SHORT_TERM_SEGMENTS);
+    if (momentary > m->momentary_max)
+        m->momentary_max = momentary;
+    if (short_term > m->short_term_max)
+        m->short_term_max = short_term;
+
+    // Blocs complets seulement, déjà filtrés par le seuil absolu
+    if (m->n_segments >= LOUDNESS_MOMENTARY_SEGMENTS && momentary >= LOUDNESS_ABSOLUTE_GATE &&
+        !energy_list_push(&m->blocks, momentary))
+        return 0;
+    if (m->n_segments >= LOUDNESS_SHORT_TERM_SEGMENTS && (m->n_segments - LOUDNESS_SHORT_TERM_SEGMENTS) % 10 == 0 &&
+        short_term >= LOUDNESS_ABSOLUTE_GATE && !energy_list_push(&m->short_terms, short_term))
+        return 0;
+    return 1;
+}
+
+// K-weighting, energy and peaks of n frames of channel c
+static void loudness_channel_run(struct loudness_meter *m, uint16_t c, const int16_t *samples, size_t n)
+{
+    struct loudness_channel *ch = &m->state[c];
+    const size_t channels = m->channels, history = TRUE_PEAK_TAPS - 1;
+    const double *s = m->shelf, *h = m->highpass;
+    float *x = m->scratch;
+
+    memcpy(x, ch->history, history * sizeof *x);
+    double z0 = ch->state[0], z1 = ch->state[1], z2 = ch->state[2], z3 = ch->state[3];
+    double energy = 0.0, peak = ch->sample_peak;
+    for (size_t i = 0; i < n; ++i)
+    {
+        double v = (double)samples[i * channels] * (1.0 / 32768.0);
+        x[history + i] = (float)v;
+        if (fabs(v) > peak)
+            peak = fabs(v);
+
+        double y = s[0] * v + z0;
+        z0 = s[1] * v - s[3] * y + z1;
+        z1 = s[2] * v - s[4] * y;
+        double w = h[0] * y + z2;
+        z2 = h[1] * y - h[3] * w + z3;
+        z3 = h[2] * y - h[4] * w;
+        energy += w * w;
+    }
+    ch->state[0] = z0;
+    ch->state[1] = z1;
+    ch->state[2] = z2;
+    ch->state[3] = z3;
+    ch->energy += energy;
+    ch->sample_peak = peak;
+
+    // Chaque échantillon suréchantillonné est un produit scalaire sur une fenêtre glissante
+    if (m->oversampling > 1)
+    {
+        float (*dot)(const float *, const float *, size_t) = kernels()->dot_f32;
+        float true_peak = (float)ch->true_peak;
+        for (size_t i = 0; i < n; ++i)
+            for (size_t p = 0; p < m->oversampling; ++p)
+            {
+                float v = fabsf(dot(m->phases + p * TRUE_PEAK_TAPS, x + i, TRUE_PEAK_TAPS));
+                if (v > true_peak)
+                    true_peak = v;
+            }
+        ch->true_peak = true_peak;
+    }
+    memcpy(ch->history, x + n, history * sizeof *x);
+}
+
+/**
+ * Pushes interleaved frames into the meter.
+ * @param m Meter created by loudness_meter_create
+ * @param samples frames * channels interleaved int16 samples
+ * @param frames Number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode loudness_meter_push(struct loudness_meter *m, const int16_t *samples, size_t frames)
+{
+    if (!m || (!samples && frames > 0))
+    {
+        set_error(ERR_INVALID_ARG, "loudness_meter_push: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    while (frames > 0)
+    {
+        // Morceaux qui ne chevauchent jamais la fin d'un segment
+        size_t n = m->segment_frames - m->segment_fill;
+        if (n > frames)
+            n = frames;
+        if (n > LOUDNESS_CHUNK)
+            n = LOUDNESS_CHUNK;
+
+        for (uint16_t c = 0; c < m->channels; ++c)
+            loudness_channel_run(m, c, samples + c, n);
+
+        m->segment_fill += n;
+        if (m->segment_fill == m->segment_frames && !loudness_segment_done(m))
+        {
+            set_error(ERR_OUT_OF_MEMORY, "loudness_meter_push: allocation failed");
+            return ERR_OUT_OF_MEMORY;
+        }
+        samples += n * m->channels;
+        frames -= n;
+    }
+    return ERR_OK;
+}
+
+// Mean of the energies at or above gate, 0 when there is none
+static double gated_mean(const struct energy_list *list, double gate)
+{
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < list->count; ++i)
+        if (list->values[i] >= gate)
+        {
+            sum += list->values[i];
+            count++;
+        }
+    return count > 0 ? sum / (double)count : 0.0;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Reads the measurements of everything pushed so far. Loudness values are in LUFS and equal -HUGE_VAL
+ * when there is not enough signal above the gates; peaks are linear (1.0 = full scale).
+ * @param m Meter created by loudness_meter_create
+ * @param out Receives the measurements
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode loudness_meter_stats(const struct loudness_meter *m, struct loudness_stats *out)
+{
+    if (!m || !out)
+    {
+        set_error(ERR_INVALID_ARG, "loudness_meter_stats: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    // Intégrée : porte absolue (-70 LUFS) puis relative (-10 LU)
+    double relative = gated_mean(&m->blocks, LOUDNESS_ABSOLUTE_GATE) * 0.1;
+    out->integrated = energy_to_loudness(gated_mean(&m->blocks, relative));
+
+    // Plage de loudness : porte relative à -20 LU, écart entre les percentiles 10 et 95
+    out->range = 0.0;
+    double gate = gated_mean(&m->short_terms, LOUDNESS_ABSOLUTE_GATE) * 0.01;
+    double *kept = m->short_terms.count > 0 ? malloc(m->short_terms.count * sizeof *kept) : NULL;
+    if (m->short_terms.count > 0 && !kept)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "loudness_meter_stats: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    size_t n_kept = 0;
+    for (size_t i = 0; i < m->short_terms.count; ++i)
+        if (m->short_terms.values[i] >= gate)
+            kept[n_kept++] = m->short_terms.values[i];
+    if (n_kept > 0)
+    {
+        qsort(kept, n_kept, sizeof *kept, compare_double);
+        size_t low = (size_t)(0.10 * (double)(n_kept - 1) + 0.5);
+        size_t high = (size_t)(0.95 * (double)(n_kept - 1) + 0.5);
+        out->range = energy_to_loudness(kept[high]) - energy_to_loudness(kept[low]);
+    }
+    free(kept);
+
+    out->momentary = energy_to_loudness(segments_energy(m, LOUDNESS_MOMENTARY_SEGMENTS));
+    out->short_term = energy_to_loudness(segments_energy(m, LOUDNESS_SHORT_TERM_SEGMENTS));
+    out->momentary_max = energy_to_loudness(m->momentary_max);
+    out->short_term_max = energy_to_loudness(m->short_term_max);
+    out->true_peak = 0.0;
+    out->sample_peak = 0.0;
+    for (uint16_t c = 0; c < m->channels; ++c)
+    {
+        double peak = m->state[c].sample_peak;
+        double true_peak = m->state[c].true_peak > peak ? m->state[c].true_peak : peak;
+        if (peak > out->sample_peak)
+            out->sample_peak = peak;
+        if (true_peak > out->true_peak)
+            out->true_peak = true_peak;
+    }
+    return ERR_OK;
+}
+
+/**
+ * Reads the true peak of one channel (linear, never below its sample peak).
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode loudness_meter_true_peak(const struct loudness_meter *m, uint16_t channel, double *out_peak)
+{
+    if (!m || !out_peak || channel >= m->channels)
+    {
+        set_error(ERR_INVALID_ARG, "loudness_meter_true_peak: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+    const struct loudness_channel *ch = &m->state[channel];
+    *out_peak = ch->true_peak > ch->sample_peak ? ch->true_peak : ch->sample_peak;
+    return ERR_OK;
+}
+
+/**
+ * Measures a whole interleaved int16 buffer in one pass (see loudness_meter_create).
+ * @param samples frames * channels interleaved samples, as produced by retrieve_wav_data
+ * @param frames Number of frames
+ * @param channels Number of channels
+ * @param sample_rate Sampling rate in Hz
+ * @param out Receives the measurements
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode loudness_measure(const int16_t *samples, uint64_t frames, uint16_t channels, uint32_t sample_rate,
+                           struct loudness_stats *out)
+{
+    if (!out || (!samples && frames > 0) || frames > SIZE_MAX / (channels ? channels : 1))
+    {
+        set_error(ERR_INVALID_ARG, "loudness_measure: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    struct loudness_meter *m;
+    ErrorCode rc = loudness_meter_create(channels, sample_rate, &m);
+    if (rc != ERR_OK)
+        return rc;
+    rc = loudness_meter_push(m, samples, (size_t)frames);
+    if (rc == ERR_OK)
+        rc = loudness_meter_stats(m, out);
+    loudness_meter_free(m);
+    return rc;
+}
+
+// ########################################## SILENCE ##########################################
+
+// Sum of squares above which a block of n samples is active, for a threshold in dBFS (RMS)
+static double silence_limit(float threshold_db, size_t n)
+{
+    double amplitude = 32768.0 * pow(10.0, (double)threshold_db / 20.0);
+    return amplitude * amplitude * (double)n;
+}
+
+// Non-zero when block b (block_length frames, the last one may be shorter) has an RMS at or above the limit
+static int block_active(const int16_t *samples, uint64_t frames, uint16_t channels, size_t block_length,
+                        float threshold_db, uint64_t b)
+{
+    uint64_t start = b * block_length;
+    size_t n = (size_t)(frames - start < block_length ? frames - start : block_length) * channels;
+    return (double)kernels()->sumsq_i16(samples + start * channels, n) >= silence_limit(threshold_db, n);
+}
+
+static int silence_args_ok(const int16_t *samples, uint64_t frames, uint16_t channels, size_t block_length)
+{
+    return (samples || frames == 0) && channels > 0 && block_length > 0 && block_length <= SIZE_MAX / channels &&
+           frames <= SIZE_MAX / channels;
+}
+
+/**
+ * Finds the active part of a signal by skipping its leading and trailing silence, like
+ * librosa.effects.trim but with an absolute threshold and non-overlapping blocks. Blocks are scanned from
+ * each end and the scan stops at the first active block, so only the silent edges are ever read.
+ * @param samples frames * channels interleaved int16 samples
+ * @param frames Number of frames
+ * @param channels Number of channels (the RMS of a block covers all of them)
+ * @param threshold_db Blocks whose RMS is below this level in dBFS are silent (e.g. -60)
+ * @param block_length Number of frames per block (e.g. 512)
+ * @param start_out Receives the first frame of the first active block
+ * @param end_out Receives the frame following the last active block (start_out == end_out when all is silent)
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode trim_silence(const int16_t *samples, uint64_t frames, uint16_t channels, float threshold_db,
+                       size_t block_length, uint64_t *start_out, uint64_t *end_out)
+{
+    if (!silence_args_ok(samples, frames, channels, block_length) || !start_out || !end_out)
+    {
+        set_error(ERR_INVALID_ARG, "trim_silence: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    const uint64_t n_blocks = (frames + block_length - 1) / block_length;
+    uint64_t first = 0;
+    while (first < n_blocks && !block_active(samples, frames, channels, block_length, threshold_db, first))
+        first++;
+    if (first == n_blocks)
+    {
+        *start_out = 0;
+        *end_out = 0;
+        return ERR_OK;
+    }
+
+    uint64_t last = n_blocks - 1;
+    while (last > first && !block_active(samples, frames, channels, block_length, threshold_db, last))
+        last--;
+
+    *start_out = first * block_length;
+    *end_out = (last + 1) * block_length < frames ? (last + 1) * block_length : frames;
+    return ERR_OK;
+}
+
+/**
+ * Splits a signal into its active regions, like librosa.effects.split but with an absolute threshold and
+ * non-overlapping blocks: silent gaps shorter than min_silence frames are bridged, then regions shorter
+ * than min_region frames are dropped.
+ * @param samples frames * channels interleaved int16 samples
+ * @param frames Number of frames
+ * @param channels Number of channels
+ * @param threshold_db Blocks whose RMS is below this level in dBFS are silent
+ * @param block_length Number of frames per block
+ * @param min_silence Shortest gap, in frames, that separates two regions (0 keeps every gap)
+ * @param min_region Shortest region kept, in frames (0 keeps them all)
+ * @param regions_out Receives a malloc'ed array of [start, end) frame ranges, in order (NULL when there is none)
+ * @param n_regions_out Receives the number of regions
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode split_silence(const int16_t *samples, uint64_t frames, uint16_t channels, float threshold_db,
+                        size_t block_length, uint64_t min_silence, uint64_t min_region,
+                        struct audio_region **regions_out, size_t *n_regions_out)
+{
+    if (!silence_args_ok(samples, frames, channels, block_length) || !regions_out || !n_regions_out)
+    {
+        set_error(ERR_INVALID_ARG, "split_silence: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    // Le rognage élimine d'abord les bords sans lire plus que nécessaire
+    uint64_t start, end;
+    trim_silence(samples, frames, channels, threshold_db, block_length, &start, &end);
+
+    struct audio_region *regions = NULL;
+    size_t count = 0, capacity = 0;
+    uint64_t b = start / block_length, b_end = (end + block_length - 1) / block_length;
+    while (b < b_end)
+    {
+        // Région courante : blocs actifs, et trous plus courts que min_silence
+        uint64_t region_start = b * block_length, region_end = region_start;
+        while (b < b_end)
+        {
+            uint64_t gap = b;
+            while (gap < b_end && !block_active(samples, frames, channels, block_length, threshold_db, gap))
+                gap++;
+            if (gap > b && (gap == b_end || (gap - b) * block_length >= min_silence))
+            {
+                b = gap;
+                break;
+            }
+            b = gap + 1;
+            region_end = b * block_length < end ? b * block_length : end;
+        }
+
+        if (region_end - region_start < min_region)
+            continue;
+        if (count == capacity)
+        {
+            size_t grown = capacity ? 2 * capacity : 16;
+            struct audio_region *tmp = realloc(regions, grown * sizeof *tmp);
+            if (!tmp)
+            {
+                free(regions);
+                set_error(ERR_OUT_OF_MEMORY, "split_silence: allocation failed");
+                return ERR_OUT_OF_MEMORY;
+            }
+            regions = tmp;
+            capacity = grown;
+        }
+        regions[count].start = region_start;
+        regions[count].end = region_end;
+        count++;
+    }
+
+    *regions_out = regions;
+    *n_regions_out = count;
+    return ERR_OK;
+}
+
+// ########################################## ONSETS AND BEATS ##########################################
+
+// Onset strength envelope of a mel spectrogram in dB (frame-major), librosa.onset.onset_strength with lag 1
+static void onset_envelope(const float *db, size_t n_frames, size_t n_mels, size_t pad_width, float *env)
+{
+    for (size_t t = 0; t < n_frames; ++t)
+    {
+        // env[t] = flux de la trame t - pad_width vers la suivante, zéro avant
+        if (t < pad_width || t - pad_width + 1 >= n_frames)
+        {
+            env[t] = 0.0f;
+            continue;
+        }
+        const float *prev = db + (t - pad_width) * n_mels, *cur = prev + n_mels;
+        float acc = 0.0f;
+        for (size_t m = 0; m < n_mels; ++m)
+            acc += cur[m] > prev[m] ? cur[m] - prev[m] : 0.0f;
+        env[t] = acc / (float)n_mels;
+    }
+}
+
+// Shared front end of the onset and beat functions: mel spectrogram in dB, then its onset envelope
+static ErrorCode onset_prepare(const char *name, const int16_t *samples, size_t N, const struct mel_params *p,
+                               float **env_out, size_t *n_frames_out)
+{
+    const struct mel_bank *bank;
+    float *mel;
+    size_t n_frames;
+    ErrorCode rc = mel_frames(name, samples, N, p, &bank, &mel, &n_frames);
+    if (rc != ERR_OK)
+        return rc;
+
+    float *env = n_frames > 0 ? malloc(n_frames * sizeof *env) : NULL;
+    if (n_frames > 0 && !env)
+    {
+        free(mel);
+        set_error(ERR_OUT_OF_MEMORY, "onset: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    if (n_frames > 0)
+    {
+        power_to_db(mel, n_frames * p->n_mels);
+        onset_envelope(mel, n_frames, p->n_mels, 1 + (p->center ? p->n_fft / (2 * p->hop_length) : 0), env);
+    }
+    free(mel);
+    *env_out = env;
+    *n_frames_out = n_frames;
+    return ERR_OK;
+}
+
+/**
+ * Computes the onset strength envelope of a signal like librosa.onset.onset_strength (mean over mel bands
+ * of the positive dB difference between consecutive frames, aligned on the frames of mel_spectrogram).
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param p Mel parameters (see mel_params_default, sample_rate from the wav_header of the file)
+ * @param onset_out Receives a malloc'ed array of n_frames_out values (NULL when there is no frame)
+ * @param n_frames_out Receives the number of frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode onset_strength(const int16_t *samples, size_t N, const struct mel_params *p, float **onset_out,
+                         size_t *n_frames_out)
+{
+    if (!onset_out || !n_frames_out)
+    {
+        set_error(ERR_INVALID_ARG, "onset_strength: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+    return onset_prepare("onset_strength: invalid argument", samples, N, p, onset_out, n_frames_out);
+}
+
+/**
+ * Fills op with the peak-picking defaults of librosa.onset.onset_detect for this frame rate:
+ * pre_max 30 ms, post_max 1 frame, pre_avg 100 ms, post_avg 100 ms + 1 frame, wait 30 ms, delta 0.07
+ */
+void onset_params_default(struct onset_params *op, uint32_t sample_rate, size_t hop_length)
+{
+    if (!op || hop_length == 0)
+        return;
+    const double frames_per_second = (double)sample_rate / (double)hop_length;
+    op->pre_max = (size_t)(0.03 * frames_per_second);
+    op->post_max = 1;
+    op->pre_avg = (size_t)(0.10 * frames_per_second);
+    op->post_avg = (size_t)(0.10 * frames_per_second) + 1;
+    op->wait = (size_t)(0.03 * frames_per_second);
+    op->delta = 0.07f;
+}
+
+// Frame indices and times (frame * hop_length / sample_rate) of the selected frames
+static ErrorCode emit_frames(const char *name, const size_t *picked, size_t n, const struct mel_params *p,
+                             size_t **frames_out, float **times_out)
+{
+    size_t *frames = NULL;
+    float *times = NULL;
+    if (n > 0)
+    {
+        frames = malloc(n * sizeof *frames);
+        times = times_out ? malloc(n * sizeof *times) : NULL;
+        if (!frames || (times_out && !times))
+        {
+            free(frames);
+            free(times);
+            set_error(ERR_OUT_OF_MEMORY, name);
+            return ERR_OUT_OF_MEMORY;
+        }
+        memcpy(frames, picked, n * sizeof *frames);
+        for (size_t i = 0; times && i < n; ++i)
+            times[i] = (float)((double)picked[i] * (double)p->hop_length / (double)p->sample_rate);
+    }
+    *frames_out = frames;
+    if (times_out)
+        *times_out = times;
+    return ERR_OK;
+}
+
+/**
+ * Detects onsets like librosa.onset.onset_detect: the onset strength envelope is normalized to [0, 1],
+ * then frame n is an onset when it is the maximum of [n - pre_max, n + post_max), reaches the mean of
+ * [n - pre_avg, n + post_avg) plus delta, and comes more than wait frames after the previous onset.
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param p Mel parameters (see mel_params_default, sample_rate from the wav_header of the file)
+ * @param op Peak-picking parameters in frames (see onset_params_default)
+ * @param frames_out Receives a malloc'ed array of onset frame indices (NULL when there is no onset)
+ * @param times_out Receives a malloc'ed array of onset times in seconds (may be NULL)
+ * @param n_onsets_out Receives the number of onsets
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode onset_detect(const int16_t *samples, size_t N, const struct mel_params *p, const struct onset_params *op,
+                       size_t **frames_out, float **times_out, size_t *n_onsets_out)
+{
+    if (!op || !frames_out || !n_onsets_out || op->pre_max + op->post_max == 0 || op->pre_avg + op->post_avg == 0)
+    {
+        set_error(ERR_INVALID_ARG, "onset_detect: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    float *env;
+    size_t n;
+    ErrorCode rc = onset_prepare("onset_detect: invalid argument", samples, N, p, &env, &n);
+    if (rc != ERR_OK)
+        return rc;
+
+    size_t *picked = n > 0 ? malloc(n * sizeof *picked) : NULL;
+    if (n > 0 && !picked)
+    {
+        free(env);
+        set_error(ERR_OUT_OF_MEMORY, "onset_detect: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    float lo = INFINITY, hi = -INFINITY;
+    for (size_t t = 0; t < n; ++t)
+    {
+        lo = env[t] < lo ? env[t] : lo;
+        hi = env[t] > hi ? env[t] : hi;
+    }
+    for (size_t t = 0; t < n; ++t)
+        env[t] = (env[t] - lo) / (hi - lo + FLT_MIN);
+
+    // Fenêtres tronquées aux bords, comme les corrections de librosa.util.peak_pick
+    size_t count = 0, last = 0;
+    int have_last = 0;
+    for (size_t t = 0; t < n; ++t)
+    {
+        if (env[t] <= 0.0f)
+            continue;
+        size_t a = t > op->pre_max ? t - op->pre_max : 0, b = t + op->post_max < n ? t + op->post_max : n;
+        int is_max = 1;
+        for (size_t k = a; k < b && is_max; ++k)
+            is_max = env[k] <= env[t];
+        if (!is_max)
+            continue;
+        a = t > op->pre_avg ? t - op->pre_avg : 0;
+        b = t + op->post_avg < n ? t + op->post_avg : n;
+        double mean = 0.0;
+        for (size_t k = a; k < b; ++k)
+            mean += env[k];
+        mean /= (double)(b - a);
+        if ((double)env[t] < mean + op->delta || (have_last && t <= last + op->wait))
+            continue;
+        picked[count++] = t;
+        last = t;
+        have_last = 1;
+    }
+    free(env);
+
+    rc = emit_frames("onset_detect: allocation failed", picked, count, p, frames_out, times_out);
+    free(picked);
+    if (rc == ERR_OK)
+        *n_onsets_out = count;
+    return rc;
+}
+
+/**
+ * Global tempo of an onset envelope, like librosa.feature.tempo: mean over frames of the autocorrelation
+ * tempogram (Hann-windowed ac_size seconds, centered with linear ramps, normalized per frame), weighted by
+ * a log-normal prior around start_bpm (1 octave deviation) and limited to 320 BPM.
+ */
+static ErrorCode estimate_tempo(const float *env, size_t n, double frame_rate, float start_bpm, double *tempo_out)
+{
+    size_t win = (size_t)(8.0 * frame_rate);
+    if (win < 4)
+        win = 4;
+    size_t n_fft = 1;
+    while (n_fft < 2 * win)
+        n_fft <<= 1;
+
+    const struct fft_plan *plan = fft_plan_get(n_fft, WINDOW_RECTANGULAR);
+    const size_t half = win / 2, n_bins = n_fft / 2 + 1;
+    float *padded = malloc((n + 2 * half) * sizeof *padded);
+    float *frame = malloc(n_fft * sizeof *frame);
+    float *window = malloc(win * sizeof *window);
+    double *tempogram = calloc(win, sizeof *tempogram);
+    struct fft_cpx *bins = malloc(n_bins * sizeof *bins);
+    struct fft_cpx *work = plan ? malloc(fft_work_size(plan) * sizeof *work) : NULL;
+    ErrorCode rc = ERR_OK;
+    if (!plan || !padded || !frame || !window || !tempogram || !bins || !work)
+    {
+        set_error(ERR_OUT_OF_MEMORY, "beat_track: allocation failed");
+        rc = ERR_OUT_OF_MEMORY;
+        goto done;
+    }
+
+    // Rampes linéaires de 0 vers les valeurs de bord (np.pad mode="linear_ramp")
+    for (size_t k = 0; k < half; ++k)
+    {
+        padded[k] = env[0] * (float)k / (float)half;
+        padded[half + n + k] = env[n - 1] * (float)(half - 1 - k) / (float)half;
+    }
+    memcpy(padded + half, env, n * sizeof *env);
+    for (size_t k = 0; k < win; ++k)
+        window[k] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * (float)k / (float)win);
+
+    for (size_t t = 0; t < n; ++t)
+    {
+        for (size_t k = 0; k < n_fft; ++k)
+            frame[k] = k < win ? padded[t + k] * window[k] : 0.0f;
+        rfft_exec(plan, frame, bins, work);
+        for (size_t k = 0; k < n_bins; ++k)
+        {
+            bins[k].re = bins[k].re * bins[k].re + bins[k].im * bins[k].im;
+            bins[k].im = 0.0f;
+        }
+        irfft_exec(plan, bins, frame, work);
+
+        float peak = 0.0f;
+        for (size_t lag = 0; lag < win; ++lag)
+            peak = fabsf(frame[lag]) > peak ? fabsf(frame[lag]) : peak;
+        const float scale = peak >= FLT_MIN ? 1.0f / peak : 1.0f;
+        for (size_t lag = 0; lag < win; ++lag)
+            tempogram[lag] += frame[lag] * scale;
+    }
+
+    double best = -INFINITY;
+    *tempo_out = 0.0;
+    for (size_t lag = 1; lag < win; ++lag)
+    {
+        double bpm = 60.0 * frame_rate / (double)lag;
+        if (bpm >= 320.0)
+            continue;
+        double prior = log2(bpm) - log2((double)start_bpm);
+        double score = log1p(1e6 * tempogram[lag] / (double)n) - 0.5 * prior * prior;
+        if (score > best)
+        {
+            best = score;
+            *tempo_out = bpm;
+        }
+    }
+
+done:
+    free(padded);
+    free(frame);
+    free(window);
+    free(tempogram);
+    free(bins);
+    free(work);
+    return rc;
+}
+
+// Onset envelope normalized by its standard deviation (ddof = 1) and smoothed by a Gaussian over +/- period
+static double beat_local_score(const float *env, size_t n, size_t period, double *localscore)
+{
+    double mean = 0.0, var = 0.0;
+    for (size_t t = 0; t < n; ++t)
+        mean += env[t];
+    mean /= (double)n;
+    for (size_t t = 0; t < n; ++t)
+        var += ((double)env[t] - mean) * ((double)env[t] - mean);
+    const double norm = (n > 1 ? sqrt(var / (double)(n - 1)) : 0.0) + DBL_MIN;
+
+    double max_score = -INFINITY;
+    for (size_t t = 0; t < n; ++t)
+    {
+        double acc = 0.0;
+        for (long k = -(long)period; k <= (long)period; ++k)
+        {
+            long j = (long)t - k;
+            if (j >= 0 && j < (long)n)
+            {
+                double x = (double)k * 32.0 / (double)period;
+                acc += exp(-0.5 * x * x) * (double)env[j] / norm;
+            }
+        }
+        localscore[t] = acc;
+        max_score = acc > max_score ? acc : max_score;
+    }
+    return max_score;
+}
+
+/**
+ * Dynamic programming of the beat tracker (Ellis 2007, librosa's __beat_track_dp with a fixed period):
+ * each frame links back to the best previous beat between 2 periods and half a period earlier, penalized
+ * by tightness * log(interval / period)^2. Frames before the first strong onset start no chain.
+ */
+static void beat_dp(const double *localscore, size_t n, size_t period, float tightness, double max_score,
+                    double *cumscore, long *backlink)
+{
+    const long nearest = lround((double)period / 2.0), farthest = 2 * (long)period;
+    int first_beat = 1;
+    for (size_t t = 0; t < n; ++t)
+    {
+        double best = -INFINITY;
+        long location = -1;
+        for (long loc = (long)t - nearest; loc >= (long)t - farthest && loc >= 0; --loc)
+        {
+            double gap = log((double)((long)t - loc)) - log((double)period);
+            double score = cumscore[loc] - (double)tightness * gap * gap;
+            if (score > best)
+            {
+                best = score;
+                location = loc;
+            }
+        }
+        cumscore[t] = localscore[t] + (location >= 0 ? best : 0.0);
+        if (first_beat && localscore[t] < 0.01 * max_score)
+            backlink[t] = -1;
+        else
+        {
+            backlink[t] = location;
+            first_beat = 0;
+        }
+    }
+}
+
+static int is_local_max(const double *x, size_t n, size_t t)
+{
+    return t > 0 && x[t] > x[t - 1] && (t + 1 == n || x[t] >= x[t + 1]);
+}
+
+// Last local maximum of the cumulative score above half the median of all its local maxima, -1 if none
+static long last_beat(const double *cumscore, size_t n, double *scratch)
+{
+    size_t n_max = 0;
+    for (size_t t = 0; t < n; ++t)
+        if (is_local_max(cumscore, n, t))
+            scratch[n_max++] = cumscore[t];
+    if (n_max == 0)
+        return -1;
+    qsort(scratch, n_max, sizeof *scratch, compare_double);
+    const double median = n_max % 2 ? scratch[n_max / 2] : 0.5 * (scratch[n_max / 2 - 1] + scratch[n_max / 2]);
+
+    long tail = -1;
+    for (size_t t = 0; t < n; ++t)
+        if (is_local_max(cumscore, n, t) && 2.0 * cumscore[t] > median)
+            tail = (long)t;
+    return tail;
+}
+
+// Keeps the beats between the first and last whose Hann-smoothed local score exceeds half its RMS
+static void trim_beats(const double *localscore, const size_t *beats, size_t count, double *smooth, size_t *first,
+                       size_t *end)
+{
+    double energy = 0.0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        // np.hanning(5) = [0, 0.5, 1, 0.5, 0], centré
+        smooth[i] = localscore[beats[i]];
+        if (i > 0)
+            smooth[i] += 0.5 * localscore[beats[i - 1]];
+        if (i + 1 < count)
+            smooth[i] += 0.5 * localscore[beats[i + 1]];
+        energy += smooth[i] * smooth[i];
+    }
+    const double threshold = 0.5 * sqrt(energy / (double)count);
+    *first = 0;
+    while (*first < count && smooth[*first] <= threshold)
+        (*first)++;
+    *end = count;
+    while (*end > *first && smooth[*end - 1] <= threshold)
+        (*end)--;
+}
+
+/**
+ * Estimates the tempo and beat positions of a signal like librosa.beat.beat_track: onset strength envelope,
+ * global tempo from its autocorrelation tempogram, dynamic-programming beat tracking, and removal of the weak
+ * beats at both ends (Hann-smoothed local score under half its RMS).
+ * @param samples Mono int16 samples
+ * @param N Number of samples
+ * @param p Mel parameters of the onset envelope (see mel_params_default, sample_rate from the wav_header)
+ * @param start_bpm Center of the tempo prior (librosa default 120)
+ * @param tightness How strictly beats follow the tempo (librosa default 100)
+ * @param tempo_out Receives the tempo in beats per minute (0 when the signal has no onset)
+ * @param frames_out Receives a malloc'ed array of beat frame indices (NULL when there is no beat)
+ * @param times_out Receives a malloc'ed array of beat times in seconds (may be NULL)
+ * @param n_beats_out Receives the number of beats
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode beat_track(const int16_t *samples, size_t N, const struct mel_params *p, float start_bpm, float tightness,
+                     double *tempo_out, size_t **frames_out, float **times_out, size_t *n_beats_out)
+{
+    if (!tempo_out || !frames_out || !n_beats_out || !(start_bpm > 0.0f) || !(tightness >= 0.0f))
+    {
+        set_error(ERR_INVALID_ARG, "beat_track: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    float *env;
+    size_t n;
+    ErrorCode rc = onset_prepare("beat_track: invalid argument", samples, N, p, &env, &n);
+    if (rc != ERR_OK)
+        return rc;
+
+    *tempo_out = 0.0;
+    *frames_out = NULL;
+    if (times_out)
+        *times_out = NULL;
+    *n_beats_out = 0;
+    int any = 0;
+    for (size_t t = 0; t < n && !any; ++t)
+        any = env[t] != 0.0f;
+    if (!any)
+    {
+        free(env);
+        return ERR_OK;
+    }
+
+    const double frame_rate = (double)p->sample_rate / (double)p->hop_length;
+    double tempo = 0.0;
+    rc = estimate_tempo(env, n, frame_rate, start_bpm, &tempo);
+
+    double *localscore = malloc(n * sizeof *localscore);
+    double *cumscore = malloc(n * sizeof *cumscore);
+    double *scratch = malloc(n * sizeof *scratch);
+    long *backlink = malloc(n * sizeof *backlink);
+    size_t *beats = malloc(n * sizeof *beats);
+    if (rc == ERR_OK && (!localscore || !cumscore || !scratch || !backlink || !beats))
+    {
+        set_error(ERR_OUT_OF_MEMORY, "beat_track: allocation failed");
+        rc = ERR_OUT_OF_MEMORY;
+    }
+
+    size_t count = 0, first = 0, end = 0;
+    if (rc == ERR_OK && tempo > 0.0)
+    {
+        size_t period = (size_t)lround(60.0 * frame_rate / tempo);
+        period = period > 0 ? period : 1;
+        double max_score = beat_local_score(env, n, period, localscore);
+        beat_dp(localscore, n, period, tightness, max_score, cumscore, backlink);
+        for (long b = last_beat(cumscore, n, scratch); b >= 0; b = backlink[b])
+            beats[count++] = (size_t)b;
+        // Chaîne remontée à l'envers
+        for (size_t i = 0; i < count / 2; ++i)
+        {
+            size_t tmp = beats[i];
+            beats[i] = beats[count - 1 - i];
+            beats[count - 1 - i] = tmp;
+        }
+        if (count > 0)
+            trim_beats(localscore, beats, count, scratch, &first, &end);
+    }
+    free(env);
+    free(localscore);
+    free(cumscore);
+    free(scratch);
+    free(backlink);
+
+    if (rc == ERR_OK)
+        rc = emit_frames("beat_track: allocation failed", beats + first, end - first, p, frames_out, times_out);
+    if (rc == ERR_OK)
+    {
+        *tempo_out = tempo;
+        *n_beats_out = end - first;
+    }
+    free(beats);
+    return rc;
+}
+
+// ########################################## RESAMPLING ##########################################
+
+// Windowed-sinc design: RESAMPLE_ZEROS zero crossings on each side of the center, Kaiser window of
+// RESAMPLE_BETA (about -96 dB stopband) and a cutoff at RESAMPLE_ROLLOFF of the lowest Nyquist frequency
+#define RESAMPLE_ZEROS 40
+#define RESAMPLE_BETA 9.6
+#define RESAMPLE_ROLLOFF 0.92
+// Largest interpolation factor (out_rate / gcd) and filter bank, in coefficients
+#define RESAMPLE_MAX_UP 4096
+#define RESAMPLE_MAX_COEFS ((size_t)1 << 24)
+
+// Coefficients are immutable once built: a filter bank is shared by every resampler of the same ratio through
+// resample_cache, which counts its users so that fft_plan_cache_clear never frees a bank still in use
+struct resample_filter {
+    uint32_t up;                 // L = out_rate / gcd
+    uint32_t down;               // M = in_rate / gcd
+    size_t half;                 // input samples after the center of each output
+    size_t taps;                 // coefficients per phase, multiple of 8 for the dot_f32 kernel
+    float *coefs;                // up x taps coefficients, oldest sample first
+    size_t users;                // live resamplers, protected by plan_cache_lock
+    struct resample_filter *next;
+};
+
+// Streaming context: planar float history of every channel, and the position of the next output
+struct resampler {
+    struct resample_filter *filter;  // one of its users, see resample_filter_release
+    uint16_t channels;
+    SampleType type;
+    float *buf;                  // channels x capacity samples, zero history first
+    size_t capacity;
+    size_t fill;                 // valid samples per channel in buf
+    size_t start;                // first sample of the window of the next output
+    uint32_t phase;              // (n * down) % up for the next output n
+    uint64_t frames_in;
+    uint64_t frames_out;
+    int finished;                // set once resampler_flush has been called
+};
+
+static uint32_t gcd_u32(uint32_t a, uint32_t b)
+{
+    while (b)
+    {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Modified Bessel function of the first kind, order 0 (power series)
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0, q = x * x / 4.0;
+    for (int k = 1; k < 200 && term > 1e-16 * sum; ++k)
+    {
+        term *= q / ((double)k * (double)k);
+        sum += term;
+    }
+    return sum;
+}
+
+static struct resample_filter *resample_filter_free(struct resample_filter *f)
+{
+    struct resample_filter *next = f->next;
+    free(f->coefs);
+    free(f);
+    return next;
+}
+
+/**
+ * Polyphase decomposition of the prototype h of 2 * half * L + 1 taps at the upsampled rate:
+ * output n reads the input samples around floor(n * M / L), coefficient j of phase p = (n * M) % L
+ * being h[p + j * L]. Each phase is normalized to a unit DC gain.
+ */
+static struct resample_filter *resample_filter_new(uint32_t up, uint32_t down)
+{
+    uint32_t widest = up > down ? up : down;
+    size_t half = up == down ? 0 : (size_t)ceil(RESAMPLE_ZEROS * (double)widest / (RESAMPLE_ROLLOFF * (double)up));
+    size_t taps = (2 * half + 1 + 7) & ~(size_t)7;
+    if ((size_t)up * taps > RESAMPLE_MAX_COEFS)
+        return NULL;
+
+    struct resample_filter *f = calloc(1, sizeof *f);
+    if (!f)
+        return NULL;
+    f->coefs = calloc((size_t)up * taps, sizeof *f->coefs);
+    if (!f->coefs)
+    {
+        free(f);
+        return NULL;
+    }
+    f->up = up;
+    f->down = down;
+    f->half = half;
+    f->taps = taps;
+    if (half == 0)
+    {
+        f->coefs[taps - 1] = 1.0f;
+        return f;
+    }
+
+    // Fréquence de coupure en cycles par échantillon suréchantillonné
+    const double fc = RESAMPLE_ROLLOFF / (2.0 * (double)widest);
+    const double length = (double)(half * up), i0_beta = bessel_i0(RESAMPLE_BETA);
+    double *h = malloc(taps * sizeof *h);
+    if (!h)
+    {
+        resample_filter_free(f);
+        return NULL;
+    }
+    for (uint32_t p = 0; p < up; ++p)
+    {
+        double sum = 0.0;
+        for (size_t k = 0; k < taps; ++k)
+        {
+            double j = (double)p + (double)k * (double)up, t = j - length;
+            h[k] = 0.0;
+            if (j > 2.0 * length)
+                continue;
+            double r = t / length, x = 2.0 * M_PI * fc * t;
+            h[k] = (fabs(x) > 1e-12 ? sin(x) / x : 1.0) * bessel_i0(RESAMPLE_BETA * sqrt(fmax(0.0, 1.0 - r * r))) / i0_beta;
+            sum += h[k];
+        }
+        for (size_t k = 0; k < taps; ++k)
+            f->coefs[(size_t)p * taps + taps - 1 - k] = (float)(h[k] / sum);
+    }
+    free(h);
+    return f;
+}
+
+// Frees the cached filter banks that no resampler uses (plan_cache_lock held)
+static void resample_cache_prune(void)
+{
+    struct resample_filter **link = &resample_cache;
+    while (*link)
+    {
+        if ((*link)->users > 0)
+            link = &(*link)->next;
+        else
+            *link = resample_filter_free(*link);
+    }
+}
+
+// Returns the cached filter bank of up / down (already reduced), building it on first use, and counts
+// the caller as one of its users until resample_filter_release
+static struct resample_filter *resample_filter_acquire(uint32_t up, uint32_t down)
+{
+    pthread_mutex_lock(&plan_cache_lock);
+    struct resample_filter *f = resample_cache;
+    while (f && (f->up != up || f->down != down))
+        f = f->next;
+    if (!f)
+    {
+        f = resample_filter_new(up, down);
+        if (f)
+        {
+            f->next = resample_cache;
+            resample_cache = f;
+        }
+    }
+    if (f)
+        ++f->users;
+    pthread_mutex_unlock(&plan_cache_lock);
+    return f;
+}
+
+static void resample_filter_release(struct resample_filter *f)
+{
+    pthread_mutex_lock(&plan_cache_lock);
+    --f->users;
+    pthread_mutex_unlock(&plan_cache_lock);
+}
+
+/**
+ * Creates a streaming sample-rate converter: polyphase windowed-sinc filter for the rational ratio
+ * out_rate / in_rate, whose filter bank is cached per ratio. The concatenation of every push and of the
+ * flush is exactly the output of resample on the whole signal.
+ * @param channels Number of interleaved channels
+ * @param in_rate Input sampling rate in Hz
+ * @param out_rate Output sampling rate in Hz
+ * @param type Sample type of both input and output (SAMPLE_S16 or SAMPLE_F32)
+ * @param out_resampler Receives the new context, to release with resampler_free
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode resampler_create(uint16_t channels, uint32_t in_rate, uint32_t out_rate, SampleType type,
+                           struct resampler **out_resampler)
+{
+    if (!out_resampler || channels == 0 || in_rate == 0 || out_rate == 0 || (type != SAMPLE_S16 && type != SAMPLE_F32))
+    {
+        set_error(ERR_INVALID_ARG, "resampler_create: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+    uint32_t g = gcd_u32(in_rate, out_rate);
+    if (out_rate / g > RESAMPLE_MAX_UP)
+    {
+        set_error(ERR_INVALID_ARG, "resampler_create: ratio too complex (out_rate / gcd > 4096)");
+        return ERR_INVALID_ARG;
+    }
+
+    struct resample_filter *filter = resample_filter_acquire(out_rate / g, in_rate / g);
+    struct resampler *rs = calloc(1, sizeof *rs);
+    if (!filter || !rs)
+    {
+        if (filter)
+            resample_filter_release(filter);
+        free(rs);
+        set_error(ERR_OUT_OF_MEMORY, "resampler_create: allocation failed");
+        return ERR_OUT_OF_MEMORY;
+    }
+    rs->filter = filter;
+    rs->channels = channels;
+    rs->type = type;
+    // Historique nul de taps - 1 échantillons : la fenêtre de la sortie 0 commence à half
+    rs->fill = filter->taps - 1;
+    rs->start = filter->half;
+
+    *out_resampler = rs;
+    return ERR_OK;
+}
+
+void resampler_free(struct resampler *rs)
+{
+    if (!rs)
+        return;
+    resample_filter_release(rs->filter);
+    free(rs->buf);
+    free(rs);
+}
+
+// Appends frames interleaved samples to the planar history (NULL samples: zeros)
+static int resampler_append(struct resampler *rs, const void *samples, size_t frames)
+{
+    if (rs->fill + frames > rs->capacity)
+    {
+        size_t capacity = rs->capacity ? rs->capacity : 4096;
+        while (capacity < rs->fill + frames)
+            capacity *= 2;
+        float *buf = calloc((size_t)rs->channels * capacity, sizeof *buf);
+        if (!buf)
+            return 0;
+        for (uint16_t c = 0; c < rs->channels && rs->buf; ++c)
+            memcpy(buf + c * capacity, rs->buf + c * rs->capacity, rs->fill * sizeof *buf);
+        free(rs->buf);
+        rs->buf = buf;
+        rs->capacity = capacity;
+    }
+
+    const size_t channels = rs->channels;
+    for (size_t c = 0; c < channels; ++c)
+    {
+        float *dst = rs->buf + c * rs->capacity + rs->fill;
+        if (!samples)
+            memset(dst, 0, frames * sizeof *dst);
+        else if (rs->type == SAMPLE_S16)
+            for (size_t i = 0; i < frames; ++i)
+                dst[i] = (float)((const int16_t *)samples)[i * channels + c] * (1.0f / 32768.0f);
+        else
+            for (size_t i = 0; i < frames; ++i)
+                dst[i] = ((const float *)samples)[i * channels + c];
+    }
+    rs->fill += frames;
+    return 1;
+}
+
+// Appends the input (and the trailing zeros on flush), then writes every output whose window is complete
+static ErrorCode resampler_feed(struct resampler *rs, const char *name, const void *samples, size_t frames,
+                                int flush, void **out_samples, size_t *out_frames)
+{
+    const struct resample_filter *f = rs->filter;
+    if (!resampler_append(rs, samples, frames) || (flush && !resampler_append(rs, NULL, f->half)))
+    {
+        set_error(ERR_OUT_OF_MEMORY, name);
+        return ERR_OUT_OF_MEMORY;
+    }
+    rs->frames_in += frames;
+
+    // Sorties n telles que start(n) + taps <= fill, start avançant de down / up échantillons par sortie
+    uint64_t count = 0;
+    if (rs->start + f->taps <= rs->fill)
+    {
+        uint64_t span = (uint64_t)(rs->fill - f->taps + 1 - rs->start) * f->up - rs->phase;
+        count = (span + f->down - 1) / f->down;
+    }
+    if (flush)
+    {
+        // ceil(frames_in * L / M) sorties au total, comme scipy.signal.resample_poly
+        uint64_t total = (rs->frames_in * f->up + f->down - 1) / f->down;
+        count = total - rs->frames_out < count ? total - rs->frames_out : count;
+    }
+
+    void *out = NULL;
+    size_t elem = rs->type == SAMPLE_S16 ? sizeof(int16_t) : sizeof(float);
+    if (count > 0 && !(out = malloc((size_t)count * rs->channels * elem)))
+    {
+        set_error(ERR_OUT_OF_MEMORY, name);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    float (*dot)(const float *, const float *, size_t) = kernels()->dot_f32;
+    const size_t channels = rs->channels;
+    size_t start = rs->start;
+    uint32_t phase = rs->phase;
+    for (size_t n = 0; n < count; ++n)
+    {
+        const float *h = f->coefs + (size_t)phase * f->taps;
+        for (size_t c = 0; c < channels; ++c)
+        {
+            float v = dot(h, rs->buf + c * rs->capacity + start, f->taps);
+            if (rs->type == SAMPLE_S16)
+                ((int16_t *)out)[n * channels + c] = f32_sample_to_s16(v);
+            else
+                ((float *)out)[n * channels + c] = v;
+        }
+        phase += f->down;
+        start += phase / f->up;
+        phase %= f->up;
+    }
+
+    // Only the samples from the window of the next output are kept
+    size_t keep = start < rs->fill ? rs->fill - start : 0;
+    for (size_t c = 0; c < channels && start > 0; ++c)
+        memmove(rs->buf + c * rs->capacity, rs->buf + c * rs->capacity + start, keep * sizeof *rs->buf);
+    rs->start = start - (rs->fill - keep);
+    rs->fill = keep;
+    rs->phase = phase;
+    rs->frames_out += count;
+
+    *out_samples = out;
+    *out_frames = (size_t)count;
+    return ERR_OK;
+}
+
+/**
+ * Pushes interleaved frames and returns every output frame they complete. Outputs lag the input by
+ * about half the filter length, returned by the next pushes or by resampler_flush.
+ * @param rs Resampler created by resampler_create
+ * @param samples frames * channels interleaved samples of the type given at creation (may be NULL when frames == 0)
+ * @param frames Number of frames
+ * @param out_samples Receives a malloc'ed array of out_frames * channels samples (NULL when no frame completed)
+ * @param out_frames Receives the number of frames produced by this push
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode resampler_push(struct resampler *rs, const void *samples, size_t frames, void **out_samples,
+                         size_t *out_frames)
+{
+    if (!rs || (!samples && frames > 0) || !out_samples || !out_frames)
+    {
+        set_error(ERR_INVALID_ARG, "resampler_push: null argument");
+        return ERR_INVALID_ARG;
+    }
+    if (rs->finished)
+    {
+        set_error(ERR_INVALID_ARG, "resampler_push: resampler already flushed");
+        return ERR_INVALID_ARG;
+    }
+    return resampler_feed(rs, "resampler_push: allocation failed", samples, frames, FALSE, out_samples, out_frames);
+}
+
+/**
+ * Ends the stream: zero-pads the input and returns the last frames, up to ceil(frames_in * out_rate / in_rate) in total.
+ * @param rs Resampler created by resampler_create
+ * @param out_samples Receives a malloc'ed array of out_frames * channels samples (NULL when no frame is left)
+ * @param out_frames Receives the number of frames produced
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode resampler_flush(struct resampler *rs, void **out_samples, size_t *out_frames)
+{
+    if (!rs || !out_samples || !out_frames)
+    {
+        set_error(ERR_INVALID_ARG, "resampler_flush: null argument");
+        return ERR_INVALID_ARG;
+    }
+    if (rs->finished)
+    {
+        *out_samples = NULL;
+        *out_frames = 0;
+        return ERR_OK;
+    }
+    rs->finished = TRUE;
+    return resampler_feed(rs, "resampler_flush: allocation failed", NULL, 0, TRUE, out_samples, out_frames);
+}
+
+/**
+ * Converts interleaved frames from in_rate to out_rate (polyphase windowed-sinc, see resampler_create).
+ * The signal is zero-padded on both sides and out_frames = ceil(frames * out_rate / in_rate), as
+ * scipy.signal.resample_poly; equal rates return a copy.
+ * @param samples frames * channels interleaved samples of the given type
+ * @param frames Number of frames
+ * @param channels Number of interleaved channels
+ * @param type Sample type of both input and output (SAMPLE_S16 or SAMPLE_F32)
+ * @param in_rate Input sampling rate in Hz
+ * @param out_rate Output sampling rate in Hz
+ * @param out_samples Receives a malloc'ed array of out_frames * channels samples
+ * @param out_frames Receives the number of output frames
+ * @return ERR_OK, or an ErrorCode (see last_error_message for details)
+ */
+ErrorCode resample(const void *samples, size_t frames, uint16_t channels, SampleType type, uint32_t in_rate,
+                   uint32_t out_rate, void **out_samples, size_t *out_frames)
+{
+    if (!samples || frames == 0 || !out_samples || !out_frames)
+    {
+        set_error(ERR_INVALID_ARG, "resample: invalid argument");
+        return ERR_INVALID_ARG;
+    }
+
+    struct resampler *rs = NULL;
+    ErrorCode rc = resampler_create(channels, in_rate, out_rate, type, &rs);
+    if (rc != ERR_OK)
+        return rc;
+    rc = resampler_feed(rs, "resample: allocation failed", samples, frames, TRUE, out_samples, out_frames);
+    resampler_free(rs);
+    return rc;
+}
+
+// ########################################## SIMD KERNELS ##########################################
+
+// Every kernel must return exactly what its scalar reference returns, the dispatch only changes speed.
+
+// Sum of |sign(x[i]) - sign(x[i-1])| over the n - 1 consecutive pairs of x
+static size_t zcr_count_i16_scalar(const int16_t *x, size_t n)
+{
+    size_t acc = 0;
+    for (size_t i = 1; i < n; ++i)
+    {
+        int diff = sgn_i16(x[i]) - sgn_i16(x[i - 1]);
+        acc += (size_t)(diff < 0 ? -diff : diff);
+    }
+    return acc;
+}
+
+// Sum of x[i]^2, exact: n * 32768^2 only overflows 64 bits past 2^34 samples
+static uint64_t sumsq_i16_scalar(const int16_t *x, size_t n)
+{
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; ++i)
+        acc += (uint64_t)((int32_t)x[i] * (int32_t)x[i]);
+    return acc;
+}
+
+// Crossings over the n - 1 pairs, sum of squares and peak magnitude of x, in a single pass
+static void frame_stats_i16_scalar(const int16_t *x, size_t n, struct frame_stats *st)
+{
+    uint64_t crossings = 0, sumsq = 0;
+    int peak = 0;
+    int prev = n > 0 ? sgn_i16(x[0]) : 0;
 
-// WAVE header structure
+    for (size_t i = 0; i < n; ++i)
+    {
+        int v = x[i];
+        int cur = sgn_i16(x[i]);
+        crossings += (uint64_t)abs(cur - prev);
+        sumsq += (uint64_t)(v * v);
+        if (abs(v) > peak)
+            peak = abs(v);
+        prev = cur;
+    }
 
-unsigned char buffer4[4];
-unsigned char buffer2[2];
+    st->crossings += crossings;
+    st->sumsq += sumsq;
+    if (peak > st->peak)
+        st->peak = peak;
+}
 
-FILE *ptr;
+// Splits n stereo frames into their left and right channels
+static void deinterleave2_i16_scalar(const int16_t *x, size_t n, int16_t *left, int16_t *right)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        left[i] = x[2 * i];
+        right[i] = x[2 * i + 1];
+    }
+}
 
-static _Thread_local ErrorContext last_error = {ERR_OK, NULL};
+// Little-endian int16 samples to float32 in [-1, 1)
+static void s16_to_f32_scalar(const unsigned char *src, size_t n, float *dst)
+{
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = (float)(int16_t)read_le16(src + 2 * i) * (1.0f / 32768.0f);
+}
 
-// ########################################## ERROR HANDLERS ##########################################
+// Little-endian packed 24-bit samples to float32 in [-1, 1)
+static void s24_to_f32_scalar(const unsigned char *src, size_t n, float *dst)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const unsigned char *p = src + 3 * i;
+        int32_t v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24);
+        dst[i] = (float)v * (1.0f / 2147483648.0f);
+    }
+}
 
-static void set_error(ErrorCode code, const char *msg)
+// Little-endian float32 samples to int16, see f32_sample_to_s16 for the rounding
+static void f32_to_s16_scalar(const unsigned char *src, size_t n, int16_t *dst)
 {
-    last_error.code = code;
-    last_error.msg = msg;
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t u = read_le32(src + 4 * i);
+        float v;
+        memcpy(&v, &u, sizeof v);
+        dst[i] = f32_sample_to_s16(v);
+    }
 }
 
-ErrorCode last_error_code(void)
+// The dot_f32 kernels round every product before adding it: GCC would otherwise contract a * b + c into an
+// FMA wherever the target has one (clang only contracts within one expression, which the kernels avoid)
+#if defined(__GNUC__) && !defined(__clang__)
+#define NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define NO_FP_CONTRACT
+#endif
+
+// Shared end of every dot_f32 kernel: folds the 8 lane sums (lane j holds the products of the indices
+// equal to j modulo 8) as (l0 + l4) + (l1 + l5) + (l2 + l6) + (l3 + l7), then adds the n < 8 remaining products
+NO_FP_CONTRACT static inline float dot_f32_finish(const float lanes[8], const float *a, const float *b, size_t n)
 {
-    return last_error.code;
+    float acc = (lanes[0] + lanes[4]) + (lanes[1] + lanes[5]) + (lanes[2] + lanes[6]) + (lanes[3] + lanes[7]);
+    for (size_t i = 0; i < n; ++i)
+    {
+        float p = a[i] * b[i];
+        acc += p;
+    }
+    return acc;
 }
 
-const char *last_error_message(void)
+// Dot product of two float vectors, accumulated in 8 lanes like the vector kernels
+NO_FP_CONTRACT static float dot_f32_scalar(const float *a, const float *b, size_t n)
 {
-    return last_error.msg ? last_error.msg : "";
+    float lanes[8] = {0.0f};
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        for (size_t j = 0; j < 8; ++j)
+        {
+            float p = a[i + j] * b[i + j];
+            lanes[j] += p;
+        }
+    return dot_f32_finish(lanes, a + i, b + i, n - i);
 }
 
-/**
- * Reads the complete WAV header (RIFF + fmt + data)
- * @param fp A pointer to a WAV file
- * @return a struct representing the WAV header
- */
-struct wav_header read_wav_header(FILE *fp)
+#if defined(AUDIOKIT_X86)
+
+// Two 4-lane accumulators: lanes 0-3 and 4-7 of the scalar reference
+NO_FP_CONTRACT __attribute__((target("sse2"))) static float dot_f32_sse2(const float *a, const float *b, size_t n)
 {
-    struct wav_header hdr;
-    memset(&hdr, 0, sizeof(hdr));
+    __m128 lo = _mm_setzero_ps(), hi = _mm_setzero_ps();
+    size_t i = 0;
 
-    // RIFF
-    fread(hdr.chunk_id, 4, 1, fp);
-    hdr.chunk_id[4] = '\0';
-    fread(&hdr.chunk_size, 4, 1, fp);
-    fread(hdr.format, 4, 1, fp);
-    hdr.format[4] = '\0';
-
-    // fmt
-    fread(hdr.subchunk1_id, 4, 1, fp);
-    hdr.subchunk1_id[4] = '\0';
-    fread(&hdr.subchunk1_size, 4, 1, fp);
-    fread(&hdr.audio_format, 2, 1, fp);
-    fread(&hdr.num_channels, 2, 1, fp);
-    fread(&hdr.sample_rate, 4, 1, fp);
-    fread(&hdr.byte_rate, 4, 1, fp);
-    fread(&hdr.block_align, 2, 1, fp);
-    fread(&hdr.bits_per_sample, 2, 1, fp);
-
-    if (hdr.subchunk1_size > 16)
-    {
-        uint16_t extra_param_size;
-        fread(&extra_param_size, 2, 1, fp);
-        fseek(fp, extra_param_size, SEEK_CUR);
-    }
-
-    // data
-    fread(hdr.subchunk2_id, 4, 1, fp);
-    hdr.subchunk2_id[4] = '\0';
-    fread(&hdr.subchunk2_size, 4, 1, fp);
+    for (; i + 8 <= n; i += 8)
+    {
+        lo = _mm_add_ps(lo, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        hi = _mm_add_ps(hi, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
 
-    return hdr;
+    float lanes[8];
+    _mm_storeu_ps(lanes, lo);
+    _mm_storeu_ps(lanes + 4, hi);
+    return dot_f32_finish(lanes, a + i, b + i, n - i);
 }
 
-int read_and_convert_data_s16le(FILE *fp,
-                                const struct wav_header *hdr,
-                                int16_t **out_samples,
-                                uint32_t *out_frames)
+// Multiply then add, never FMA: the single rounding of an FMA would change the result
+NO_FP_CONTRACT __attribute__((target("avx2"))) static float dot_f32_avx2(const float *a, const float *b, size_t n)
 {
-    if (!fp || !hdr || !out_samples || !out_frames)
-        return -1;
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
 
-    // Vérifs de format: PCM 16-bit little-endian
-    if (hdr->audio_format != 1)
-        return -2; // non-PCM
-    if (hdr->bits_per_sample != 16)
-        return -3; // non 16-bit
-    if (hdr->block_align != hdr->num_channels * 2)
-        return -4;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
 
-    const uint16_t channels = hdr->num_channels;
-    const uint16_t bytes_per_frame = hdr->block_align;
-    const uint32_t data_size = hdr->subchunk2_size;
+    float lanes[8];
+    _mm256_storeu_ps(lanes, acc);
+    return dot_f32_finish(lanes, a + i, b + i, n - i);
+}
 
-    if (data_size == 0)
-        return -5;
-    if ((data_size % bytes_per_frame) != 0)
-        return -6; // taille pas multiple d'une frame
+__attribute__((target("sse2"))) static void deinterleave2_i16_sse2(const int16_t *x, size_t n, int16_t *left, int16_t *right)
+{
+    size_t i = 0;
 
-    const uint32_t frames = data_size / bytes_per_frame;
-    const size_t total_samples = (size_t)frames * (size_t)channels;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(x + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(x + 2 * i + 8));
+        // Canal gauche = moitié basse de chaque paire (extension de signe), droit = moitié haute
+        __m128i la = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        __m128i lb = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        __m128i ra = _mm_srai_epi32(a, 16);
+        __m128i rb = _mm_srai_epi32(b, 16);
+        // Les valeurs tiennent sur 16 bits : packs ne sature jamais
+        _mm_storeu_si128((__m128i *)(left + i), _mm_packs_epi32(la, lb));
+        _mm_storeu_si128((__m128i *)(right + i), _mm_packs_epi32(ra, rb));
+    }
+    deinterleave2_i16_scalar(x + 2 * i, n - i, left + i, right + i);
+}
 
-    int16_t *dst = (int16_t *)malloc(total_samples * sizeof(int16_t));
-    if (!dst)
-        return -7;
+__attribute__((target("sse2"))) static void s16_to_f32_sse2(const unsigned char *src, size_t n, float *dst)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
 
-    // Lecture par blocs pour éviter un énorme buffer temporaire
-    // Taille cible ~64 KiB, ajustée pour tomber sur un nombre entier de frames
-    size_t target_bytes = 64 * 1024;
-    size_t frames_per_chunk = target_bytes / bytes_per_frame;
-    if (frames_per_chunk == 0)
-        frames_per_chunk = 1;
-    size_t chunk_bytes = frames_per_chunk * (size_t)bytes_per_frame;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        // Extension de signe : on place chaque int16 dans la moitié haute d'un int32 puis on décale
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), x), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    s16_to_f32_scalar(src + 2 * i, n - i, dst + i);
+}
+
+__attribute__((target("ssse3"))) static void s24_to_f32_ssse3(const unsigned char *src, size_t n, float *dst)
+{
+    // Chaque échantillon de 3 octets va dans les 3 octets hauts d'un int32 (octet bas à zéro)
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+    size_t i = 0;
 
-    unsigned char *chunk = (unsigned char *)malloc(chunk_bytes);
-    if (!chunk)
+    // 16 octets chargés pour 12 utilisés : on s'arrête avant de lire au-delà du buffer
+    for (; i + 6 <= n; i += 4)
     {
-        free(dst);
-        return -8;
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+        __m128i v = _mm_shuffle_epi8(x, shuffle);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
     }
+    s24_to_f32_scalar(src + 3 * i, n - i, dst + i);
+}
 
-    uint32_t frames_done = 0;
-    size_t out_idx = 0;
+__attribute__((target("sse2"))) static void f32_to_s16_sse2(const unsigned char *src, size_t n, int16_t *dst)
+{
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    size_t i = 0;
 
-    while (frames_done < frames)
+    for (; i + 8 <= n; i += 8)
     {
-        uint32_t remaining = frames - frames_done;
-        size_t this_frames = remaining < frames_per_chunk ? remaining : frames_per_chunk;
-        size_t this_bytes = this_frames * (size_t)bytes_per_frame;
+        // max/min renvoient leur second opérande sur NaN : même résultat que f32_sample_to_s16
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps((const float *)(src + 4 * i)), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps((const float *)(src + 4 * i + 16)), lo), hi);
+        // 1.0 * 32768 sature à 32767 dans packs
+        __m128i r = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)), _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+        _mm_storeu_si128((__m128i *)(dst + i), r);
+    }
+    f32_to_s16_scalar(src + 4 * i, n - i, dst + i);
+}
 
-        size_t got = fread(chunk, 1, this_bytes, fp);
-        if (got != this_bytes)
-        {
-            free(chunk);
-            free(dst);
-            return -9; // lecture incomplète/erreur
-        }
+__attribute__((target("sse2"))) static size_t zcr_count_i16_sse2(const int16_t *x, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
 
-        // Convertir ce bloc
-        for (size_t f = 0; f < this_frames; ++f)
-        {
-            size_t base = f * (size_t)bytes_per_frame;
-            for (uint16_t ch = 0; ch < channels; ++ch)
-            {
-                size_t off = base + (size_t)ch * 2; // 2 octets par sample
-                // Little-endian: low, high
-                uint16_t u = (uint16_t)chunk[off] | ((uint16_t)chunk[off + 1] << 8);
-                dst[out_idx++] = (int16_t)u;
-            }
-        }
+    // 8 paires par itération : x[i..i+7] contre x[i+1..i+8]
+    for (; i + 9 <= n; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(x + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(x + i + 1));
+        // sign = (x < 0 ? -1 : 0) - (x > 0 ? -1 : 0)
+        __m128i sa = _mm_sub_epi16(_mm_cmpgt_epi16(zero, a), _mm_cmpgt_epi16(a, zero));
+        __m128i sb = _mm_sub_epi16(_mm_cmpgt_epi16(zero, b), _mm_cmpgt_epi16(b, zero));
+        __m128i d = _mm_sub_epi16(sb, sa);
+        d = _mm_max_epi16(d, _mm_sub_epi16(zero, d));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(d, ones));
+    }
+
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    size_t total = (size_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    if (i + 1 < n)
+        total += zcr_count_i16_scalar(x + i, n - i);
+    return total;
+}
+
+__attribute__((target("sse2"))) static uint64_t sumsq_i16_sse2(const int16_t *x, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
 
-        frames_done += (uint32_t)this_frames;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(x + i));
+        // a0² + a1² <= 2^31 : exact once read as unsigned 32-bit, then widened to 64-bit lanes
+        __m128i sq = _mm_madd_epi16(a, a);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
     }
 
-    free(chunk);
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    return lanes[0] + lanes[1] + sumsq_i16_scalar(x + i, n - i);
+}
 
-    // Sorties
-    *out_samples = dst;
-    *out_frames = frames;
-    return 0;
+__attribute__((target("avx2"))) static uint64_t sumsq_i16_avx2(const int16_t *x, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(x + i));
+        __m256i sq = _mm256_madd_epi16(a, a);
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(sq, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(sq, zero));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumsq_i16_scalar(x + i, n - i);
 }
 
-int retrieve_wav_data(char *filename, struct wav_header *out_wh, int16_t **out_samples, uint32_t *out_frames)
+__attribute__((target("sse2"))) static void frame_stats_i16_sse2(const int16_t *x, size_t n, struct frame_stats *st)
 {
-    // We initiate the file pointer
-    FILE *fp;
-    // We open the file
-    fp = fopen(filename, "rb");
-    // We read the header of the wav file we opened
-    *out_wh = read_wav_header(fp);
-    // We initiate the pointers that allow us to store the wav file data
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i cross = _mm_setzero_si128();
+    __m128i sumsq = _mm_setzero_si128();
+    __m128i vmax = _mm_setzero_si128();
+    __m128i vmin = _mm_setzero_si128();
+    size_t i = 0;
 
-    int error_code = read_and_convert_data_s16le(fp, out_wh, out_samples, out_frames);
-    return error_code;
+    for (; i + 9 <= n; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(x + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(x + i + 1));
+
+        __m128i sa = _mm_sub_epi16(_mm_cmpgt_epi16(zero, a), _mm_cmpgt_epi16(a, zero));
+        __m128i sb = _mm_sub_epi16(_mm_cmpgt_epi16(zero, b), _mm_cmpgt_epi16(b, zero));
+        __m128i d = _mm_sub_epi16(sb, sa);
+        d = _mm_max_epi16(d, _mm_sub_epi16(zero, d));
+        cross = _mm_add_epi32(cross, _mm_madd_epi16(d, ones));
+
+        __m128i sq = _mm_madd_epi16(a, a);
+        sumsq = _mm_add_epi64(sumsq, _mm_unpacklo_epi32(sq, zero));
+        sumsq = _mm_add_epi64(sumsq, _mm_unpackhi_epi32(sq, zero));
+
+        // |-32768| ne tient pas sur 16 bits : on garde min et max séparément
+        vmax = _mm_max_epi16(vmax, a);
+        vmin = _mm_min_epi16(vmin, a);
+    }
+
+    uint32_t c[4];
+    uint64_t q[2];
+    int16_t hi[8], lo[8];
+    _mm_storeu_si128((__m128i *)c, cross);
+    _mm_storeu_si128((__m128i *)q, sumsq);
+    _mm_storeu_si128((__m128i *)hi, vmax);
+    _mm_storeu_si128((__m128i *)lo, vmin);
+
+    int peak = 0;
+    for (int k = 0; k < 8; ++k)
+    {
+        if (hi[k] > peak)
+            peak = hi[k];
+        if (-(int)lo[k] > peak)
+            peak = -(int)lo[k];
+    }
+
+    st->crossings += (uint64_t)c[0] + c[1] + c[2] + c[3];
+    st->sumsq += q[0] + q[1];
+    if (peak > st->peak)
+        st->peak = peak;
+    // Reste : x[i..n-1], la paire (i-1, i) a déjà été comptée par la boucle vectorielle
+    if (i < n)
+        frame_stats_i16_scalar(x + i, n - i, st);
 }
 
-/**
- * Prints the read header from the WAV file
- * @param wh a struct representing the WAV header
- */
-void print_wav_header(struct wav_header wh)
+__attribute__((target("avx2"))) static void frame_stats_i16_avx2(const int16_t *x, size_t n, struct frame_stats *st)
 {
-    printf("ChunkID\t\t\t%s\n", wh.chunk_id);
-    printf("ChunkSize\t\t%" PRIu32 "\n", wh.chunk_size);
-    printf("Format\t\t\t%s\n\n", wh.format);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i cross = _mm256_setzero_si256();
+    __m256i sumsq = _mm256_setzero_si256();
+    __m256i vmax = _mm256_setzero_si256();
+    __m256i vmin = _mm256_setzero_si256();
+    size_t i = 0;
 
-    printf("Subchunk1ID\t\t%s\n", wh.subchunk1_id);
-    printf("Subchunk1Size\t%" PRIu32 "\n", wh.subchunk1_size);
-    printf("AudioFormat\t\t%" PRIu16 "\n", wh.audio_format);
-    printf("NumChannels\t\t%" PRIu16 "\n", wh.num_channels);
-    printf("SampleRate\t\t%" PRIu32 "\n", wh.sample_rate);
-    printf("ByteRate\t\t%" PRIu32 "\n", wh.byte_rate);
-    printf("BlockAlign\t\t%" PRIu16 "\n", wh.block_align);
-    printf("BitsPerSample\t%" PRIu16 "\n\n", wh.bits_per_sample);
+    for (; i + 17 <= n; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(x + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(x + i + 1));
 
-    printf("Subchunk2ID\t\t%s\n", wh.subchunk2_id);
-    printf("Subchunk2Size\t%" PRIu32 "\n", wh.subchunk2_size);
+        __m256i sa = _mm256_sub_epi16(_mm256_cmpgt_epi16(zero, a), _mm256_cmpgt_epi16(a, zero));
+        __m256i sb = _mm256_sub_epi16(_mm256_cmpgt_epi16(zero, b), _mm256_cmpgt_epi16(b, zero));
+        __m256i d = _mm256_abs_epi16(_mm256_sub_epi16(sb, sa));
+        cross = _mm256_add_epi32(cross, _mm256_madd_epi16(d, ones));
+
+        __m256i sq = _mm256_madd_epi16(a, a);
+        sumsq = _mm256_add_epi64(sumsq, _mm256_unpacklo_epi32(sq, zero));
+        sumsq = _mm256_add_epi64(sumsq, _mm256_unpackhi_epi32(sq, zero));
+
+        vmax = _mm256_max_epi16(vmax, a);
+        vmin = _mm256_min_epi16(vmin, a);
+    }
+
+    uint32_t c[8];
+    uint64_t q[4];
+    int16_t hi[16], lo[16];
+    _mm256_storeu_si256((__m256i *)c, cross);
+    _mm256_storeu_si256((__m256i *)q, sumsq);
+    _mm256_storeu_si256((__m256i *)hi, vmax);
+    _mm256_storeu_si256((__m256i *)lo, vmin);
+
+    uint64_t crossings = 0;
+    int peak = 0;
+    for (int k = 0; k < 8; ++k)
+        crossings += c[k];
+    for (int k = 0; k < 16; ++k)
+    {
+        if (hi[k] > peak)
+            peak = hi[k];
+        if (-(int)lo[k] > peak)
+            peak = -(int)lo[k];
+    }
+
+    st->crossings += crossings;
+    st->sumsq += q[0] + q[1] + q[2] + q[3];
+    if (peak > st->peak)
+        st->peak = peak;
+    if (i < n)
+        frame_stats_i16_scalar(x + i, n - i, st);
 }
 
-/**
- * Prints the data from the buffer data specified
- * This code only works for a PCM format equal to 1, and a bits per sample value equal to 16
- * @param wh a struct representing the WAV header
- * @param buffer Pointer to unsigned char* that will point to audio data
- */
-void print_data(struct wav_header *wh, unsigned char *buffer, int frames_to_print)
+__attribute__((target("avx2"))) static size_t zcr_count_i16_avx2(const int16_t *x, size_t n)
 {
-    const int channels = wh->num_channels;
-    const int bytes_per_sample = wh->bits_per_sample / 8; // supposé 2 ici
-    const int bytes_per_frame = wh->block_align;          // = channels * bytes_per_sample
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
 
-    if (wh->audio_format != 1 || wh->bits_per_sample != 16)
+    // 16 paires par itération : x[i..i+15] contre x[i+1..i+16]
+    for (; i + 17 <= n; i += 16)
     {
-        fprintf(stderr, "Cette fonction suppose PCM 16-bit.\n");
-        return;
+        __m256i a = _mm256_loadu_si256((const __m256i *)(x + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(x + i + 1));
+        __m256i sa = _mm256_sub_epi16(_mm256_cmpgt_epi16(zero, a), _mm256_cmpgt_epi16(a, zero));
+        __m256i sb = _mm256_sub_epi16(_mm256_cmpgt_epi16(zero, b), _mm256_cmpgt_epi16(b, zero));
+        __m256i d = _mm256_abs_epi16(_mm256_sub_epi16(sb, sa));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(d, ones));
     }
 
-    int max_frames = (int)(wh->subchunk2_size / bytes_per_frame);
-    if (frames_to_print > max_frames)
-        frames_to_print = max_frames;
+    uint32_t lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    size_t total = 0;
+    for (int k = 0; k < 8; ++k)
+        total += lanes[k];
+    if (i + 1 < n)
+        total += zcr_count_i16_scalar(x + i, n - i);
+    return total;
+}
 
-    for (int f = 0; f < frames_to_print; ++f)
+#elif defined(AUDIOKIT_NEON)
+
+// Separate vmulq / vaddq, as on x86: no fused multiply-add
+NO_FP_CONTRACT static float dot_f32_neon(const float *a, const float *b, size_t n)
+{
+    float32x4_t lo = vdupq_n_f32(0.0f), hi = vdupq_n_f32(0.0f);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
     {
-        size_t base = (size_t)f * (size_t)bytes_per_frame;
-        printf("%d.", f);
+        lo = vaddq_f32(lo, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+        hi = vaddq_f32(hi, vmulq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4)));
+    }
 
-        for (int ch = 0; ch < channels; ++ch)
-        {
-            size_t off = base + (size_t)ch * (size_t)bytes_per_sample;
+    float lanes[8];
+    vst1q_f32(lanes, lo);
+    vst1q_f32(lanes + 4, hi);
+    return dot_f32_finish(lanes, a + i, b + i, n - i);
+}
 
-            // Little-endian: low, high
-            uint16_t u = (uint16_t)buffer[off] | ((uint16_t)buffer[off + 1] << 8);
-            int16_t s = (int16_t)u; // interprétation signée (audio classique)
+static void deinterleave2_i16_neon(const int16_t *x, size_t n, int16_t *left, int16_t *right)
+{
+    size_t i = 0;
 
-            // Affiche signé (valeur audio) et non signé si tu veux comparer
-            printf(" ch%d:%d(u=%u hex=0x%04X)", ch, (int)s, (unsigned)u, (unsigned)u);
-        }
-        printf("\n");
+    for (; i + 8 <= n; i += 8)
+    {
+        int16x8x2_t lr = vld2q_s16(x + 2 * i);
+        vst1q_s16(left + i, lr.val[0]);
+        vst1q_s16(right + i, lr.val[1]);
     }
+    deinterleave2_i16_scalar(x + 2 * i, n - i, left + i, right + i);
 }
 
-int amplitude_envelope(char *filename)
+static size_t zcr_count_i16_neon(const int16_t *x, size_t n)
 {
-    return 0;
+    const int16x8_t zero = vdupq_n_s16(0);
+    int32x4_t acc = vdupq_n_s32(0);
+    size_t i = 0;
+
+    for (; i + 9 <= n; i += 8)
+    {
+        int16x8_t a = vld1q_s16(x + i);
+        int16x8_t b = vld1q_s16(x + i + 1);
+        int16x8_t sa = vsubq_s16(vreinterpretq_s16_u16(vcltq_s16(a, zero)), vreinterpretq_s16_u16(vcgtq_s16(a, zero)));
+        int16x8_t sb = vsubq_s16(vreinterpretq_s16_u16(vcltq_s16(b, zero)), vreinterpretq_s16_u16(vcgtq_s16(b, zero)));
+        acc = vpadalq_s16(acc, vabsq_s16(vsubq_s16(sb, sa)));
+    }
+
+    int32x2_t half = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    size_t total = (size_t)(uint32_t)vget_lane_s32(vpadd_s32(half, half), 0);
+    if (i + 1 < n)
+        total += zcr_count_i16_scalar(x + i, n - i);
+    return total;
 }
 
-int rms(char *filename)
+static uint64_t sumsq_i16_neon(const int16_t *x, size_t n)
 {
-    return 0;
+    uint64x2_t acc = vdupq_n_u64(0);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        int16x8_t a = vld1q_s16(x + i);
+        // x² <= 2^30 : les produits 32 bits sont exacts et positifs
+        int32x4_t lo = vmull_s16(vget_low_s16(a), vget_low_s16(a));
+        int32x4_t hi = vmull_s16(vget_high_s16(a), vget_high_s16(a));
+        acc = vpadalq_u32(acc, vreinterpretq_u32_s32(lo));
+        acc = vpadalq_u32(acc, vreinterpretq_u32_s32(hi));
+    }
+
+    return vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1) + sumsq_i16_scalar(x + i, n - i);
 }
 
-ErrorCode zero_crossing_rate(
-    const int16_t *samples,
-    size_t N,
-    size_t frame_length,
-    size_t hop_length,
-    int center,
-    float **zcr_out, 
-    size_t *n_frames_out)
+static void frame_stats_i16_neon(const int16_t *x, size_t n, struct frame_stats *st)
 {
-    if (!samples || !zcr_out || !n_frames_out || frame_length < 2 || hop_length == 0)
-        return ERR_INVALID_ARG;
+    const int16x8_t zero = vdupq_n_s16(0);
+    int32x4_t cross = vdupq_n_s32(0);
+    uint64x2_t sumsq = vdupq_n_u64(0);
+    int16x8_t vmax = zero, vmin = zero;
+    size_t i = 0;
 
-    size_t pad = center ? frame_length / 2 : 0;
-    size_t total_len = N + 2 * pad;
-    size_t n_frames = (total_len < frame_length)
-                          ? 0
-                          : 1 + (total_len - frame_length) / hop_length;
+    for (; i + 9 <= n; i += 8)
+    {
+        int16x8_t a = vld1q_s16(x + i);
+        int16x8_t b = vld1q_s16(x + i + 1);
 
-    *n_frames_out = n_frames;
+        int16x8_t sa = vsubq_s16(vreinterpretq_s16_u16(vcltq_s16(a, zero)), vreinterpretq_s16_u16(vcgtq_s16(a, zero)));
+        int16x8_t sb = vsubq_s16(vreinterpretq_s16_u16(vcltq_s16(b, zero)), vreinterpretq_s16_u16(vcgtq_s16(b, zero)));
+        cross = vpadalq_s16(cross, vabsq_s16(vsubq_s16(sb, sa)));
 
-    if (n_frames == 0)
+        sumsq = vpadalq_u32(sumsq, vreinterpretq_u32_s32(vmull_s16(vget_low_s16(a), vget_low_s16(a))));
+        sumsq = vpadalq_u32(sumsq, vreinterpretq_u32_s32(vmull_s16(vget_high_s16(a), vget_high_s16(a))));
+
+        vmax = vmaxq_s16(vmax, a);
+        vmin = vminq_s16(vmin, a);
+    }
+
+    int32_t c[4];
+    int16_t hi[8], lo[8];
+    vst1q_s32(c, cross);
+    vst1q_s16(hi, vmax);
+    vst1q_s16(lo, vmin);
+
+    int peak = 0;
+    for (int k = 0; k < 8; ++k)
     {
-        *zcr_out = NULL;
-        return ERR_OK;
+        if (hi[k] > peak)
+            peak = hi[k];
+        if (-(int)lo[k] > peak)
+            peak = -(int)lo[k];
     }
 
-    float *buf = malloc(n_frames * sizeof *buf);
-    if (!buf)
-        return ERR_OUT_OF_MEMORY; // selon tes codes d’erreur
+    st->crossings += (uint64_t)(uint32_t)c[0] + (uint32_t)c[1] + (uint32_t)c[2] + (uint32_t)c[3];
+    st->sumsq += vgetq_lane_u64(sumsq, 0) + vgetq_lane_u64(sumsq, 1);
+    if (peak > st->peak)
+        st->peak = peak;
+    if (i < n)
+        frame_stats_i16_scalar(x + i, n - i, st);
+}
 
-    for (size_t f = 0; f < n_frames; ++f)
+#endif
+
+static struct simd_kernels active_kernels;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+// Picks the widest implementation supported by the running CPU, once per process
+static void kernels_init(void)
+{
+    active_kernels.zcr_count_i16 = zcr_count_i16_scalar;
+    active_kernels.sumsq_i16 = sumsq_i16_scalar;
+    active_kernels.frame_stats_i16 = frame_stats_i16_scalar;
+    active_kernels.s16_to_f32 = s16_to_f32_scalar;
+    active_kernels.s24_to_f32 = s24_to_f32_scalar;
+    active_kernels.f32_to_s16 = f32_to_s16_scalar;
+    active_kernels.deinterleave2_i16 = deinterleave2_i16_scalar;
+    active_kernels.dot_f32 = dot_f32_scalar;
+
+#if defined(AUDIOKIT_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
     {
-        size_t start = f * hop_length;
-        // Dans la zone paddée, les échantillons “hors signal” valent 0
-        // On itère sur les (frame_length - 1) paires consécutives
-        float acc = 0.0f;
-        for (size_t k = 1; k < frame_length; ++k)
-        {
-            // indices dans le signal “paddé virtuellement”
-            size_t idx0 = start + k - 1;
-            size_t idx1 = start + k;
-
-            int16_t x0 = 0, x1 = 0;
-            // map de l’index paddé vers l’index réel [0..N)
-            if (idx0 >= pad && idx0 < pad + N)
-                x0 = samples[idx0 - pad];
-            if (idx1 >= pad && idx1 < pad + N)
-                x1 = samples[idx1 - pad];
-
-            int s0 = sgn_i16(x0);
-            int s1 = sgn_i16(x1);
-            // |sign(x[n]) - sign(x[n-1])| ∈ {0,1,2}
-            int diff = s1 - s0;
-            if (diff < 0)
-                diff = -diff;
-            acc += (float)diff;
-        }
-        // zcr_frame = 0.5 * mean(diff)  = 0.5 * acc / (frame_length - 1)
-        buf[f] = 0.5f * acc / (float)(frame_length - 1);
+        active_kernels.s16_to_f32 = s16_to_f32_sse2;
+        active_kernels.f32_to_s16 = f32_to_s16_sse2;
+        active_kernels.deinterleave2_i16 = deinterleave2_i16_sse2;
+        active_kernels.zcr_count_i16 = zcr_count_i16_sse2;
+        active_kernels.sumsq_i16 = sumsq_i16_sse2;
+        active_kernels.frame_stats_i16 = frame_stats_i16_sse2;
+        active_kernels.dot_f32 = dot_f32_sse2;
     }
-    *zcr_out = buf;
-    return ERR_OK;
+    if (__builtin_cpu_supports("ssse3"))
+        active_kernels.s24_to_f32 = s24_to_f32_ssse3;
+    if (__builtin_cpu_supports("avx2"))
+    {
+        active_kernels.zcr_count_i16 = zcr_count_i16_avx2;
+        active_kernels.sumsq_i16 = sumsq_i16_avx2;
+        active_kernels.frame_stats_i16 = frame_stats_i16_avx2;
+        active_kernels.dot_f32 = dot_f32_avx2;
+    }
+#elif defined(AUDIOKIT_NEON)
+    active_kernels.zcr_count_i16 = zcr_count_i16_neon;
+    active_kernels.sumsq_i16 = sumsq_i16_neon;
+    active_kernels.frame_stats_i16 = frame_stats_i16_neon;
+    active_kernels.deinterleave2_i16 = deinterleave2_i16_neon;
+    active_kernels.dot_f32 = dot_f32_neon;
+#endif
+}
+
+static const struct simd_kernels *kernels(void)
+{
+    pthread_once(&kernels_once, kernels_init);
+    return &active_kernels;
+}
+
+// The vector kernels accumulate in 32-bit lanes: we feed them blocks small enough never to overflow
+#define ZCR_KERNEL_BLOCK ((size_t)1 << 24)
+
+static size_t zcr_count(const int16_t *x, size_t n)
+{
+    size_t (*kernel)(const int16_t *, size_t) = kernels()->zcr_count_i16;
+    size_t total = 0;
+    // Consecutive blocks share one sample so that no pair is lost at the seams
+    while (n > ZCR_KERNEL_BLOCK)
+    {
+        total += kernel(x, ZCR_KERNEL_BLOCK + 1);
+        x += ZCR_KERNEL_BLOCK;
+        n -= ZCR_KERNEL_BLOCK;
+    }
+    return total + kernel(x, n);
 }
 
 // ########################################## ACCESSING META-DATA ##########################################
@@ -333,6 +6240,21 @@ static inline int sgn_i16(int16_t x)
     return (x > 0) - (x < 0); // -1, 0, +1
 }
 
+
+// Number of frames of length frame_length, hop_length apart, in the (optionally centered) signal
+static size_t frame_count(size_t N, size_t frame_length, size_t hop_length, int center)
+{
+    size_t pad = center ? frame_length / 2 : 0;
+    size_t total_len = N + 2 * pad;
+    return (total_len < frame_length) ? 0 : 1 + (total_len - frame_length) / hop_length;
+}
+
+// zcr_frame = 0.5 * mean(diff) = 0.5 * count / (frame_length - 1)
+static inline float zcr_from_count(size_t count, size_t frame_length)
+{
+    return 0.5f * (float)count / (float)(frame_length - 1);
+}
+
 /**
  * Convert seconds into hh:mm:ss format
  * Params:
@@ -369,22 +6291,33 @@ static char *seconds_to_time(float raw_seconds)
 int main(int argc, char **argv)
 {
     struct wav_header wh;
-    int16_t *samples = NULL;
-    uint32_t frames = 0;
-    int error_code = retrieve_wav_data(argv[1], &wh, &samples, &frames);
+    struct planar_audio audio;
+    if (argc < 2 || retrieve_wav_data_planar(argv[1], &wh, &audio) != ERR_OK)
+    {
+        fprintf(stderr, "usage: %s file.wav (%s)\n", argv[0], argc < 2 ? "missing file" : last_error_message());
+        return 1;
+    }
 
     print_wav_header(wh);
-    printf("Value of frames variable : %d\n", frames);
-
-    float *zcr_output = NULL;
-    size_t n_frames = 0;
+    printf("Value of frames variable : %" PRIu64 "\n", audio.frames);
 
-    zero_crossing_rate(samples, frames, 2048, 512, 0, &zcr_output, &n_frames);
+    // Un ZCR par canal : les échantillons entrelacés ne forment pas un signal
+    struct feature_set zcr = {0};
+    if (extract_features_planar(NULL, &audio, 2048, 512, 0, FEATURE_ZCR, &zcr) != ERR_OK)
+    {
+        fprintf(stderr, "%s\n", last_error_message());
+        planar_audio_free(&audio);
+        return 1;
+    }
 
-    for (int i = 0; i < n_frames; i++)
+    for (uint16_t ch = 0; ch < audio.channels; ch++)
     {
-        printf("frame %d : %f\n", i, zcr_output[i]);
+        for (size_t i = 0; i < zcr.n_frames; i++)
+        {
+            printf("channel %u frame %zu : %f\n", (unsigned)ch, i, zcr.zcr[(size_t)ch * zcr.n_frames + i]);
+        }
     }
-    free(zcr_output);
+    free(zcr.zcr);
+    planar_audio_free(&audio);
     return 0;
 }
\ No newline at end of file
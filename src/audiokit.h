@@ -5,7 +5,7 @@
 struct wav_header {
     // RIFF chunk descriptor
     char     chunk_id[5];    // "RIFF"
-    uint32_t chunk_size;     // taille fichier - 8
+    uint64_t chunk_size;     // taille fichier - 8 (64 bits pour RF64/BW64)
     char     format[5];      // "WAVE"
 
     // fmt subchunk
@@ -20,7 +20,47 @@ struct wav_header {
 
     // data subchunk
     char     subchunk2_id[5]; // "data"
-    uint32_t subchunk2_size;  // nombre d’octets de données
+    uint64_t subchunk2_size;  // nombre d’octets de données (64 bits pour RF64/BW64)
+
+    // chunk layout, as found by the RIFF chunk walker
+    uint64_t fmt_offset;      // offset du payload "fmt " dans le fichier
+    uint64_t data_offset;     // offset du premier échantillon dans le fichier
+
+    // effective sample encoding (SubFormat for WAVE_FORMAT_EXTENSIBLE, audio_format otherwise)
+    uint16_t sample_format;   // WAVE_FORMAT_PCM ou WAVE_FORMAT_IEEE_FLOAT
+};
+
+// wFormatTag values understood by the decoder
+#define WAVE_FORMAT_PCM        0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+// Channels kept by the decoder
+typedef enum {
+    CHANNELS_ALL = 0,         // every channel, interleaved
+    CHANNELS_DOWNMIX,         // mean of the channels (mono)
+    CHANNELS_SELECT           // channels[0 .. n_channels) in that order, interleaved
+} ChannelMode;
+
+struct channel_selection {
+    ChannelMode mode;
+    const uint16_t *channels; // CHANNELS_SELECT only, indices may repeat
+    uint16_t n_channels;
+};
+
+// Sample type produced by the decoder, whatever the encoding of the file
+typedef enum {
+    SAMPLE_S16 = 0,           // int16, full scale = 32768
+    SAMPLE_F32 = 1            // float32 in [-1, 1)
+} SampleType;
+
+// Read-only view over the data chunk of a WAV file, see retrieve_wav_data_mmap
+struct wav_mapping {
+    struct wav_header header;
+    const int16_t *samples;   // interleaved samples (points into the mapping when map_base != NULL)
+    uint64_t frames;          // number of frames (samples per channel)
+    void    *map_base;        // base address of the mapping, NULL when samples is an owned copy
+    size_t   map_length;      // length of the mapping in bytes
 };
 
 
@@ -48,11 +88,27 @@ ErrorCode last_error_code(void);
 const char *last_error_message(void);
 
 
-// This function is used to calculate the amplidute envelope of a loaded wav file
-int amplitude_envelope(char * filename);
+// This function is used to calculate the framewise amplitude envelope of a loaded wav file
+ErrorCode amplitude_envelope(
+    const int16_t *samples,
+    size_t N,
+    size_t frame_length,
+    size_t hop_length,
+    int center,
+    float **envelope_out,
+    size_t *n_frames_out
+);
 
-// This function is used to calculate the RMS (root-mean-square energy) of a loaded wav file
-int rms(char * filename);
+// This function is used to calculate the framewise RMS (root-mean-square energy) of a loaded wav file
+ErrorCode rms(
+    const int16_t *samples,
+    size_t N,
+    size_t frame_length,
+    size_t hop_length,
+    int center,
+    float **rms_out,
+    size_t *n_frames_out
+);
 
 // This function is used to calculate the ZCR (zero-crossing rate) of a loaded wav file
 ErrorCode zero_crossing_rate(
@@ -65,22 +121,395 @@ ErrorCode zero_crossing_rate(
     size_t *n_frames_out
 );
 
+// Opaque table of crossing prefix sums, reusable across frame configurations
+struct zcr_prefix;
+
+// This function is used to build the crossing prefix sums of a signal in a single pass
+ErrorCode zcr_prefix_build(const int16_t *samples, size_t N, struct zcr_prefix **out_prefix);
+
+// This function is used to calculate the ZCR of any frame configuration from prebuilt prefix sums
+ErrorCode zero_crossing_rate_prefix(
+    const struct zcr_prefix *prefix,
+    size_t frame_length,
+    size_t hop_length,
+    int center,
+    float **zcr_out,
+    size_t *n_frames_out
+);
+
+void zcr_prefix_free(struct zcr_prefix *prefix);
+
+// ########################################## FLOAT FEATURES ##########################################
+
+// These functions are the float32 variants of the feature functions (samples in [-1, 1))
+ErrorCode zero_crossing_rate_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, int center,
+                                 float **zcr_out, size_t *n_frames_out);
+
+ErrorCode rms_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, int center,
+                  float **rms_out, size_t *n_frames_out);
+
+ErrorCode amplitude_envelope_f32(const float *samples, size_t N, size_t frame_length, size_t hop_length, int center,
+                                 float **envelope_out, size_t *n_frames_out);
+
+// ########################################## MULTI-FEATURE ##########################################
+
+// Bitmask of the features computed by extract_features
+typedef enum {
+    FEATURE_ZCR      = 1 << 0,
+    FEATURE_RMS      = 1 << 1,
+    FEATURE_ENVELOPE = 1 << 2,
+    FEATURE_ALL      = FEATURE_ZCR | FEATURE_RMS | FEATURE_ENVELOPE
+} FeatureFlags;
+
+// Outputs of extract_features, one value per frame for each requested feature
+struct feature_set {
+    float *zcr;
+    float *rms;
+    float *envelope;
+    size_t n_frames;
+};
+
+// This function is used to know up front how many frames a feature function will produce
+size_t feature_frame_count(size_t N, size_t frame_length, size_t hop_length, int center);
+
+// This function is used to calculate several features of a loaded wav file in a single pass
+ErrorCode extract_features(
+    const int16_t *samples,
+    size_t N,
+    size_t frame_length,
+    size_t hop_length,
+    int center,
+    unsigned features,
+    struct feature_set *out
+);
+
+// ########################################## OUTPUT BUFFERS ##########################################
+
+// These functions are the variants of the feature functions writing into a caller buffer of capacity values
+// (feature_frame_count gives the size needed up front)
+ErrorCode zero_crossing_rate_into(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length,
+                                  int center, float *zcr_out, size_t capacity, size_t *n_frames_out);
+
+ErrorCode rms_into(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length, int center,
+                   float *rms_out, size_t capacity, size_t *n_frames_out);
+
+ErrorCode amplitude_envelope_into(const int16_t *samples, size_t N, size_t frame_length, size_t hop_length,
+                                  int center, float *envelope_out, size_t capacity, size_t *n_frames_out);
+
+// Opaque bump allocator holding all the outputs of one file, released in one call
+struct feature_arena;
+
+ErrorCode feature_arena_create(size_t block_size, struct feature_arena **out_arena);
+
+void *feature_arena_alloc(struct feature_arena *arena, size_t bytes);
+
+// This function is used to point the requested arrays of a feature_set to arena memory
+ErrorCode feature_arena_alloc_set(struct feature_arena *arena, unsigned features, size_t n_frames, struct feature_set *out);
+
+void feature_arena_reset(struct feature_arena *arena);
+
+void feature_arena_free(struct feature_arena *arena);
+
+// ########################################## MULTITHREADING ##########################################
+
+// Opaque pool of persistent worker threads shared by the *_mt variants
+struct thread_pool;
+
+// This function is used to start a pool of n_threads threads (caller included, 0 = one per online CPU)
+ErrorCode thread_pool_create(size_t n_threads, struct thread_pool **out_pool);
+
+void thread_pool_free(struct thread_pool *pool);
+
+size_t thread_pool_size(const struct thread_pool *pool);
+
+// These functions are the multithreaded variants of the feature functions (pool may be NULL)
+ErrorCode zero_crossing_rate_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length,
+                                size_t hop_length, int center, float **zcr_out, size_t *n_frames_out);
+
+ErrorCode rms_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length,
+                 size_t hop_length, int center, float **rms_out, size_t *n_frames_out);
+
+ErrorCode amplitude_envelope_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length,
+                                size_t hop_length, int center, float **envelope_out, size_t *n_frames_out);
+
+ErrorCode extract_features_mt(struct thread_pool *pool, const int16_t *samples, size_t N, size_t frame_length,
+                              size_t hop_length, int center, unsigned features, struct feature_set *out);
+
+// ########################################## BATCH ##########################################
+
+// Features and framing computed for every file of a batch
+struct feature_spec {
+    unsigned features;  // FeatureFlags
+    size_t frame_length;
+    size_t hop_length;
+    int center;
+};
+
+// Outcome of one file of a batch
+struct file_result {
+    ErrorCode status;          // ERR_OK, or the error that stopped this file
+    const char *message;       // error details when status != ERR_OK
+    struct wav_header header;
+    uint64_t frames;
+    struct feature_set features;
+};
+
+// This function is used to load and analyze many wav files concurrently
+ErrorCode analyze_files(struct thread_pool *pool, const char *const *paths, size_t n_paths,
+                        const struct feature_spec *spec, struct file_result *results);
+
+void file_results_free(struct file_result *results, size_t n_paths);
+
+// ########################################## PLANAR ##########################################
+
+// Channel-major samples (structure of arrays): channel c is data[c * frames .. (c + 1) * frames)
+struct planar_audio {
+    int16_t *data;
+    uint16_t channels;
+    uint64_t frames;
+};
+
+// This function is used to split interleaved samples into one contiguous buffer per channel
+ErrorCode deinterleave_s16(const int16_t *interleaved, uint64_t frames, uint16_t channels, struct planar_audio *out);
+
+// This function is used to load a wav file directly in planar layout
+ErrorCode retrieve_wav_data_planar(const char *filename, struct wav_header *out_wh, struct planar_audio *out);
+
+void planar_audio_free(struct planar_audio *audio);
+
+// This function is used to calculate the features of every channel, one output row per channel
+ErrorCode extract_features_planar(struct thread_pool *pool, const struct planar_audio *audio, size_t frame_length,
+                                  size_t hop_length, int center, unsigned features, struct feature_set *out);
+
+// ########################################## STREAMING ##########################################
+
+// Opaque streaming context carrying the frame overlap between pushes
+struct feature_stream;
+
+// This function is used to create a streaming context emitting the ZCR of each completed frame
+ErrorCode feature_stream_create(size_t frame_length, size_t hop_length, int center, struct feature_stream **out_stream);
+
+// This function is used to push samples and retrieve the ZCR of the frames they complete
+ErrorCode feature_stream_push(struct feature_stream *st, const int16_t *samples, size_t n, float **zcr_out, size_t *n_frames_out);
+
+// This function is used to end a stream and retrieve its last frames
+ErrorCode feature_stream_flush(struct feature_stream *st, float **zcr_out, size_t *n_frames_out);
+
+void feature_stream_free(struct feature_stream *st);
+
+// ########################################## SPECTRAL ##########################################
+
+// Analysis windows (periodic, as scipy.signal.get_window(..., fftbins=True) used by librosa)
+typedef enum {
+    WINDOW_HANN = 0,
+    WINDOW_HAMMING,
+    WINDOW_RECTANGULAR
+} WindowType;
+
+// Opaque FFT plan (factorization, twiddles and window), cached per (size, window)
+struct fft_plan;
+
+// These functions are used to compute real FFTs of any size, (re, im) pairs for the n / 2 + 1 bins
+ErrorCode rfft(const float *x, size_t n, float *spectrum_out);
+
+ErrorCode irfft(const float *spectrum, size_t n, float *x_out);
+
+void fft_plan_cache_clear(void);
+
+// This function is used to calculate the STFT of a loaded wav file, frame-major complex spectrum
+ErrorCode stft(const int16_t *samples, size_t N, size_t n_fft, size_t hop_length, int center, WindowType window,
+               float **spectrum_out, size_t *n_bins_out, size_t *n_frames_out);
+
+// This function is used to calculate the magnitude (power = 1) or power (power = 2) spectrogram
+ErrorCode stft_magnitude(const int16_t *samples, size_t N, size_t n_fft, size_t hop_length, int center,
+                         WindowType window, float power, float **magnitude_out, size_t *n_bins_out,
+                         size_t *n_frames_out);
+
+// This function is used to rebuild a signal from its STFT by weighted overlap-add
+ErrorCode istft(const float *spectrum, size_t n_fft, size_t n_frames, size_t hop_length, int center, WindowType window,
+                size_t length, float **signal_out, size_t *n_out);
+
+// ########################################## MEL ##########################################
+
+// Mel spectrogram parameters, see mel_params_default for the librosa defaults
+struct mel_params {
+    uint32_t sample_rate;
+    size_t n_fft;
+    size_t hop_length;
+    int center;
+    WindowType window;
+    float power;              // 1 = magnitude, 2 = power
+    size_t n_mels;
+    float fmin;
+    float fmax;               // <= 0 : sample_rate / 2
+};
+
+// Opaque sparse mel filterbank and DCT-II, cached per (sample_rate, n_fft, n_mels, fmin, fmax)
+struct mel_bank;
+
+void mel_params_default(struct mel_params *p, uint32_t sample_rate);
+
+// This function is used to export the mel filterbank as a dense n_mels x (n_fft / 2 + 1) matrix
+ErrorCode mel_filterbank(const struct mel_params *p, float **weights_out);
+
+// This function is used to calculate the mel spectrogram of a loaded wav file, frame-major
+ErrorCode mel_spectrogram(const int16_t *samples, size_t N, const struct mel_params *p, float **mel_out,
+                          size_t *n_frames_out);
+
+// This function is used to calculate the MFCCs of a loaded wav file, frame-major
+ErrorCode mfcc(const int16_t *samples, size_t N, const struct mel_params *p, size_t n_mfcc, float **mfcc_out,
+               size_t *n_frames_out);
+
+// ########################################## SPECTRAL FEATURES ##########################################
+
+// This function is used to calculate spectral centroid, bandwidth, rolloff, flatness and flux from one STFT,
+// a NULL output pointer skips its feature
+ErrorCode spectral_features(const int16_t *samples, size_t N, uint32_t sample_rate, size_t n_fft, size_t hop_length,
+                            int center, WindowType window, float roll_percent, float **centroid_out,
+                            float **bandwidth_out, float **rolloff_out, float **flatness_out, float **flux_out,
+                            size_t *n_frames_out);
+
+// This function is used to calculate the same features from a frame-major magnitude spectrogram
+ErrorCode spectral_features_from_magnitude(const float *magnitude, size_t n_bins, size_t n_frames,
+                                           uint32_t sample_rate, float roll_percent, float **centroid_out,
+                                           float **bandwidth_out, float **rolloff_out, float **flatness_out,
+                                           float **flux_out, size_t *n_frames_out);
+
+// ########################################## PITCH ##########################################
+
+// This function is used to estimate the fundamental frequency of each frame with YIN (FFT autocorrelation)
+ErrorCode yin(const int16_t *samples, size_t N, uint32_t sample_rate, size_t frame_length, size_t hop_length,
+              int center, float fmin, float fmax, float trough_threshold, float **f0_out, size_t *n_frames_out);
+
+// ########################################## LOUDNESS ##########################################
+
+// Measurements of a loudness meter: loudness in LUFS (-HUGE_VAL below the gates), range in LU, linear peaks
+struct loudness_stats {
+    double integrated;
+    double range;
+    double momentary;         // last 400 ms
+    double short_term;        // last 3 s
+    double momentary_max;
+    double short_term_max;
+    double true_peak;         // 4x oversampled below 96 kHz, 2x below 192 kHz, none above; max over channels
+    double sample_peak;
+};
+
+// Opaque streaming meter with per-channel K-weighting and true-peak state
+struct loudness_meter;
+
+// These functions are used to measure EBU R128 / BS.1770 loudness in a single pass over int16 frames
+ErrorCode loudness_meter_create(uint16_t channels, uint32_t sample_rate, struct loudness_meter **out_meter);
+
+ErrorCode loudness_meter_push(struct loudness_meter *m, const int16_t *samples, size_t frames);
+
+ErrorCode loudness_meter_stats(const struct loudness_meter *m, struct loudness_stats *out);
+
+ErrorCode loudness_meter_true_peak(const struct loudness_meter *m, uint16_t channel, double *out_peak);
+
+void loudness_meter_free(struct loudness_meter *m);
+
+ErrorCode loudness_measure(const int16_t *samples, uint64_t frames, uint16_t channels, uint32_t sample_rate,
+                           struct loudness_stats *out);
+
+// ########################################## SILENCE ##########################################
+
+// Range of frames [start, end)
+struct audio_region {
+    uint64_t start;
+    uint64_t end;
+};
+
+// This function is used to find the frames left once leading and trailing silence are skipped
+ErrorCode trim_silence(const int16_t *samples, uint64_t frames, uint16_t channels, float threshold_db,
+                       size_t block_length, uint64_t *start_out, uint64_t *end_out);
+
+// This function is used to find the active regions of a signal, separated by long enough silences
+ErrorCode split_silence(const int16_t *samples, uint64_t frames, uint16_t channels, float threshold_db,
+                        size_t block_length, uint64_t min_silence, uint64_t min_region,
+                        struct audio_region **regions_out, size_t *n_regions_out);
+
+// ########################################## ONSETS AND BEATS ##########################################
+
+// Peak-picking parameters of onset_detect, in frames (see onset_params_default)
+struct onset_params {
+    size_t pre_max;
+    size_t post_max;
+    size_t pre_avg;
+    size_t post_avg;
+    size_t wait;
+    float delta;
+};
+
+// This function is used to calculate the onset strength envelope (mel spectral flux) of a loaded wav file
+ErrorCode onset_strength(const int16_t *samples, size_t N, const struct mel_params *p, float **onset_out,
+                         size_t *n_frames_out);
+
+void onset_params_default(struct onset_params *op, uint32_t sample_rate, size_t hop_length);
+
+// This function is used to find the onset frames and times of a loaded wav file
+ErrorCode onset_detect(const int16_t *samples, size_t N, const struct mel_params *p, const struct onset_params *op,
+                       size_t **frames_out, float **times_out, size_t *n_onsets_out);
+
+// This function is used to estimate the tempo and beat frames and times of a loaded wav file
+ErrorCode beat_track(const int16_t *samples, size_t N, const struct mel_params *p, float start_bpm, float tightness,
+                     double *tempo_out, size_t **frames_out, float **times_out, size_t *n_beats_out);
+
+// ########################################## RESAMPLING ##########################################
+
+// Opaque streaming sample-rate converter (polyphase windowed sinc, filter banks cached per ratio)
+struct resampler;
+
+// These functions are used to convert interleaved int16 or float32 frames to another sampling rate, chunk by chunk
+ErrorCode resampler_create(uint16_t channels, uint32_t in_rate, uint32_t out_rate, SampleType type,
+                           struct resampler **out_resampler);
+
+ErrorCode resampler_push(struct resampler *rs, const void *samples, size_t frames, void **out_samples,
+                         size_t *out_frames);
+
+ErrorCode resampler_flush(struct resampler *rs, void **out_samples, size_t *out_frames);
+
+void resampler_free(struct resampler *rs);
+
+// This function is used to convert a whole interleaved signal to another sampling rate
+ErrorCode resample(const void *samples, size_t frames, uint16_t channels, SampleType type, uint32_t in_rate,
+                   uint32_t out_rate, void **out_samples, size_t *out_frames);
+
 // ########################################## HELPERS ##########################################
 
 static char *seconds_to_time(float seconds);
 
-static inline int sgn_i16(int16_t x);
-
 // ########################################## NEW METHODS ##########################################
 
 
 int check_file_format(FILE* fp);
 
+ErrorCode parse_wav_header(FILE *fp, struct wav_header *out_wh);
+
 struct wav_header read_wav_header(FILE *fp);
 
-int read_and_convert_data_s16le(FILE *fp, const struct wav_header *hdr, int16_t **out_samples, uint32_t *out_frames);
+ErrorCode probe_wav_file(const char *filename, struct wav_header *out_wh);
+
+ErrorCode read_and_convert_data(FILE *fp, const struct wav_header *hdr, SampleType out_type, void **out_samples, uint64_t *out_frames);
+
+ErrorCode read_and_convert_data_channels(FILE *fp, const struct wav_header *hdr, SampleType out_type, const struct channel_selection *sel,
+                                         void **out_samples, uint64_t *out_frames, uint16_t *out_channels);
+
+int read_and_convert_data_s16le(FILE *fp, const struct wav_header *hdr, int16_t **out_samples, uint64_t *out_frames);
+
+int retrieve_wav_data(char *filename, struct wav_header *out_wh, int16_t **out_samples, uint64_t *out_frames);
+
+ErrorCode retrieve_wav_data_as(const char *filename, SampleType out_type, struct wav_header *out_wh, void **out_samples, uint64_t *out_frames);
+
+ErrorCode retrieve_wav_data_channels(const char *filename, SampleType out_type, const struct channel_selection *sel,
+                                     struct wav_header *out_wh, void **out_samples, uint64_t *out_frames, uint16_t *out_channels);
+
+ErrorCode retrieve_wav_data_range(const char *filename, SampleType out_type, uint64_t start_frame, uint64_t n_frames,
+                                  struct wav_header *out_wh, void **out_samples, uint64_t *out_frames);
+
+ErrorCode retrieve_wav_data_mmap(const char *filename, struct wav_mapping *out_map);
 
-int retrieve_wav_data(char *filename, struct wav_header *out_wh, int16_t **out_samples, uint32_t *out_frames);
+void release_wav_data_mmap(struct wav_mapping *map);
 
 void print_wav_header(struct wav_header wh);
 